@@ -11,9 +11,9 @@ glslc -fshader-stage=fragment basic.frag.glsl -o basic.frag.spv
 ECHO Built Shaders "basic"
 popd
 
-REM Gets list of all C files
+REM Gets list of all C files (tests\ builds separately with tests\build_tests.bat)
 SET c_filenames= 
-FOR /R %%f in (*.c) do (
+FOR /R source %%f in (*.c) do (
 	SET c_filenames=!c_filenames! %%f
 )
 
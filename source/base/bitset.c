@@ -0,0 +1,210 @@
+#include "bitset.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void* bitset_alloc(M_Arena* arena, u64 size) {
+    if (arena) return arena_alloc_aligned(arena, size, sizeof(u64));
+    return malloc(size);
+}
+
+//~ Bitset
+
+void bitset_init(Bitset* set, u64 bit_count, M_Arena* arena) {
+    set->bit_count = bit_count;
+    set->word_count = Bitset_WordCount(bit_count);
+    set->arena = arena;
+    set->words = bitset_alloc(arena, set->word_count * sizeof(u64));
+    memset(set->words, 0, set->word_count * sizeof(u64));
+}
+
+void bitset_free(Bitset* set) {
+    if (!set->arena) free(set->words);
+    set->words = nullptr;
+    set->bit_count = 0;
+    set->word_count = 0;
+}
+
+void bitset_clear_all(Bitset* set) {
+    memset(set->words, 0, set->word_count * sizeof(u64));
+}
+
+void bitset_set_all(Bitset* set) {
+    memset(set->words, 0xFF, set->word_count * sizeof(u64));
+    if (set->bit_count & 63) set->words[set->word_count - 1] = (1ull << (set->bit_count & 63)) - 1;
+}
+
+u64 bitset_count(Bitset* set) {
+    u64 count = 0;
+    for (u64 i = 0; i < set->word_count; i++) count += bits_popcount64(set->words[i]);
+    return count;
+}
+
+void bitset_and(Bitset* dst, Bitset* a, Bitset* b) {
+    for (u64 i = 0; i < dst->word_count; i++) dst->words[i] = a->words[i] & b->words[i];
+}
+
+void bitset_or(Bitset* dst, Bitset* a, Bitset* b) {
+    for (u64 i = 0; i < dst->word_count; i++) dst->words[i] = a->words[i] | b->words[i];
+}
+
+void bitset_xor(Bitset* dst, Bitset* a, Bitset* b) {
+    for (u64 i = 0; i < dst->word_count; i++) dst->words[i] = a->words[i] ^ b->words[i];
+}
+
+void bitset_andnot(Bitset* dst, Bitset* a, Bitset* b) {
+    for (u64 i = 0; i < dst->word_count; i++) dst->words[i] = a->words[i] & ~b->words[i];
+}
+
+u64 bitset_find_next_set(Bitset* set, u64 from) {
+    if (from >= set->bit_count) return Bitset_None;
+    u64 index = from >> 6;
+    u64 word = set->words[index] & (u64_max << (from & 63));
+    while (!word) {
+        if (++index == set->word_count) return Bitset_None;
+        word = set->words[index];
+    }
+    return index * 64 + bits_ctz64(word);
+}
+
+u64 bitset_find_next_clear(Bitset* set, u64 from) {
+    if (from >= set->bit_count) return Bitset_None;
+    u64 index = from >> 6;
+    u64 word = ~set->words[index] & (u64_max << (from & 63));
+    while (!word) {
+        if (++index == set->word_count) return Bitset_None;
+        word = ~set->words[index];
+    }
+    u64 bit = index * 64 + bits_ctz64(word);
+    return bit < set->bit_count ? bit : Bitset_None;
+}
+
+//~ Hierarchical Bitmap
+
+// Marks every child that exists at each summary level as having clear bits
+static void hbitmap_reset_free_summary(HBitmap* map) {
+    for (u32 level = 1; level < map->level_count; level++) {
+        u64 children = map->level_words[level - 1];
+        u64* words = map->free_summary[level];
+        memset(words, 0xFF, map->level_words[level] * sizeof(u64));
+        if (children & 63) words[map->level_words[level] - 1] = (1ull << (children & 63)) - 1;
+    }
+}
+
+void hbitmap_init(HBitmap* map, u64 bit_count, M_Arena* arena) {
+    MemoryZeroStruct(map, *map);
+    map->bit_count = bit_count;
+    map->arena = arena;
+
+    u64 words = Bitset_WordCount(Max(bit_count, 1));
+    u64 total = 0;
+    for (;;) {
+        Assert((map->level_count < HBitmap_MaxLevels), "HBitmap of %llu bits needs too many levels", bit_count);
+        map->level_words[map->level_count++] = words;
+        total += words;
+        if (words == 1) break;
+        words = Bitset_WordCount(words);
+    }
+
+    // Leaves, then a set and a free summary word array per level above them
+    map->memory_size = (total * 2 - map->level_words[0]) * sizeof(u64);
+    map->memory = bitset_alloc(arena, map->memory_size);
+    memset(map->memory, 0, map->memory_size);
+    u64* cursor = map->memory;
+    map->leaves = cursor;
+    cursor += map->level_words[0];
+    for (u32 level = 1; level < map->level_count; level++) {
+        map->set_summary[level] = cursor;
+        cursor += map->level_words[level];
+        map->free_summary[level] = cursor;
+        cursor += map->level_words[level];
+    }
+    hbitmap_reset_free_summary(map);
+}
+
+void hbitmap_free(HBitmap* map) {
+    if (!map->arena) free(map->memory);
+    MemoryZeroStruct(map, *map);
+}
+
+void hbitmap_clear_all(HBitmap* map) {
+    memset(map->leaves, 0, map->level_words[0] * sizeof(u64));
+    for (u32 level = 1; level < map->level_count; level++) {
+        memset(map->set_summary[level], 0, map->level_words[level] * sizeof(u64));
+    }
+    hbitmap_reset_free_summary(map);
+}
+
+// Summary bits only change when a word crosses between empty/non-empty or full/non-full,
+// and only propagate further up while the parent word crosses too.
+static void hbitmap_summary_set(u64** summary, u32 level_count, u64 child) {
+    for (u32 level = 1; level < level_count; level++) {
+        u64* word = &summary[level][child >> 6];
+        u64 old = *word;
+        *word |= 1ull << (child & 63);
+        if (old) return;
+        child >>= 6;
+    }
+}
+
+static void hbitmap_summary_clear(u64** summary, u32 level_count, u64 child) {
+    for (u32 level = 1; level < level_count; level++) {
+        u64* word = &summary[level][child >> 6];
+        *word &= ~(1ull << (child & 63));
+        if (*word) return;
+        child >>= 6;
+    }
+}
+
+void hbitmap_set(HBitmap* map, u64 bit) {
+    u64 index = bit >> 6;
+    u64 old = map->leaves[index];
+    u64 new = old | (1ull << (bit & 63));
+    if (old == new) return;
+    map->leaves[index] = new;
+    if (old == 0) hbitmap_summary_set(map->set_summary, map->level_count, index);
+    if (new == u64_max) hbitmap_summary_clear(map->free_summary, map->level_count, index);
+}
+
+void hbitmap_clear(HBitmap* map, u64 bit) {
+    u64 index = bit >> 6;
+    u64 old = map->leaves[index];
+    u64 new = old & ~(1ull << (bit & 63));
+    if (old == new) return;
+    map->leaves[index] = new;
+    if (new == 0) hbitmap_summary_clear(map->set_summary, map->level_count, index);
+    if (old == u64_max) hbitmap_summary_set(map->free_summary, map->level_count, index);
+}
+
+static inline u64 hbitmap_word(HBitmap* map, u32 level, u64 index, b8 want_set) {
+    if (level == 0) return want_set ? map->leaves[index] : ~map->leaves[index];
+    return want_set ? map->set_summary[level][index] : map->free_summary[level][index];
+}
+
+// Climbs until some word at or after the position has a candidate bit, then descends through
+// the first candidate child at each level. Each level costs one word read either way.
+static u64 hbitmap_find_next(HBitmap* map, u64 from, b8 want_set) {
+    if (from >= map->bit_count) return Bitset_None;
+    u64 position = from;
+    for (u32 level = 0; level < map->level_count; level++) {
+        u64 index = position >> 6;
+        if (index >= map->level_words[level]) return Bitset_None;
+        u64 word = hbitmap_word(map, level, index, want_set) & (u64_max << (position & 63));
+        if (word) {
+            position = index * 64 + bits_ctz64(word);
+            while (level--) {
+                position = position * 64 + bits_ctz64(hbitmap_word(map, level, position, want_set));
+            }
+            return position < map->bit_count ? position : Bitset_None;
+        }
+        position = index + 1;
+    }
+    return Bitset_None;
+}
+
+u64 hbitmap_find_next_set(HBitmap* map, u64 from) {
+    return hbitmap_find_next(map, from, true);
+}
+
+u64 hbitmap_find_next_clear(HBitmap* map, u64 from) {
+    return hbitmap_find_next(map, from, false);
+}
@@ -0,0 +1,120 @@
+/* date = October 17th 2026 10:12 am */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include "defines.h"
+#include "mem.h"
+
+#if defined(COMPILER_CL)
+#  include <intrin.h>
+#endif
+
+#define Bitset_None u64_max
+#define Bitset_WordCount(bits) (((bits) + 63) / 64)
+
+//~ Word helpers
+// These work on plain u64 arrays too, for fixed-size bitsets that live inside a struct.
+
+static inline u32 bits_ctz64(u64 word) {
+#if defined(COMPILER_CL)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// Index of the highest set bit
+static inline u32 bits_msb64(u64 word) {
+#if defined(COMPILER_CL)
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return index;
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+static inline u32 bits_popcount64(u64 word) {
+#if defined(COMPILER_CL)
+    return (u32) __popcnt64(word);
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+static inline void bits_set(u64* words, u64 bit)   { words[bit >> 6] |=  (1ull << (bit & 63)); }
+static inline void bits_clear(u64* words, u64 bit) { words[bit >> 6] &= ~(1ull << (bit & 63)); }
+static inline b8   bits_test(u64* words, u64 bit)  { return (words[bit >> 6] >> (bit & 63)) & 1; }
+
+//~ Bitset
+// Heap backed unless an arena is passed to bitset_init. Bits past bit_count are kept clear.
+
+typedef struct Bitset {
+    u64* words;
+    u64 bit_count;
+    u64 word_count;
+    M_Arena* arena;
+} Bitset;
+
+void bitset_init(Bitset* set, u64 bit_count, M_Arena* arena);
+void bitset_free(Bitset* set);
+
+static inline void bitset_set(Bitset* set, u64 bit)   { bits_set(set->words, bit); }
+static inline void bitset_clear(Bitset* set, u64 bit) { bits_clear(set->words, bit); }
+static inline b8   bitset_test(Bitset* set, u64 bit)  { return bits_test(set->words, bit); }
+
+void bitset_clear_all(Bitset* set);
+void bitset_set_all(Bitset* set);
+u64  bitset_count(Bitset* set);
+
+// dst may alias a or b. All three must have the same bit_count.
+void bitset_and(Bitset* dst, Bitset* a, Bitset* b);
+void bitset_or(Bitset* dst, Bitset* a, Bitset* b);
+void bitset_xor(Bitset* dst, Bitset* a, Bitset* b);
+void bitset_andnot(Bitset* dst, Bitset* a, Bitset* b);
+
+// Return Bitset_None when there is no such bit at or after from
+u64 bitset_find_next_set(Bitset* set, u64 from);
+u64 bitset_find_next_clear(Bitset* set, u64 from);
+
+#define BitsetIterate(set, var) \
+for (u64 var = bitset_find_next_set(set, 0); var != Bitset_None; var = bitset_find_next_set(set, var + 1))
+
+//~ Hierarchical Bitmap
+// A bitset with summary levels above it: each summary bit says whether a 64-bit word below it
+// has any set bit, and a second summary says whether it has any clear bit. Finding the next
+// set or clear bit walks at most one word per level, so finding a free slot among 1M bits
+// touches 4 words instead of scanning 16K.
+
+#define HBitmap_MaxLevels 6
+
+typedef struct HBitmap {
+    u64 bit_count;
+    u32 level_count;
+    u64 level_words[HBitmap_MaxLevels];
+    u64* leaves;
+    u64* set_summary[HBitmap_MaxLevels];  // Level 0 unused, the leaves are their own summary
+    u64* free_summary[HBitmap_MaxLevels];
+    M_Arena* arena;
+    void* memory;
+    u64 memory_size;
+} HBitmap;
+
+void hbitmap_init(HBitmap* map, u64 bit_count, M_Arena* arena);
+void hbitmap_free(HBitmap* map);
+void hbitmap_set(HBitmap* map, u64 bit);
+void hbitmap_clear(HBitmap* map, u64 bit);
+void hbitmap_clear_all(HBitmap* map);
+
+static inline b8 hbitmap_test(HBitmap* map, u64 bit) { return bits_test(map->leaves, bit); }
+
+u64 hbitmap_find_next_set(HBitmap* map, u64 from);
+u64 hbitmap_find_next_clear(HBitmap* map, u64 from);
+
+#define HBitmapIterate(map, var) \
+for (u64 var = hbitmap_find_next_set(map, 0); var != Bitset_None; var = hbitmap_find_next_set(map, var + 1))
+
+#endif //BITSET_H
@@ -5,34 +5,71 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include "mem.h"
+
+#if defined(COMPILER_CL)
+#  include <intrin.h>
+#endif
 
 #define DoubleCapacity(x) ((x) <= 0 ? 8 : x * 2)
 
 #define Iterate(array, var) for (int var = 0; var < array.len; var++)
 #define IteratePtr(array, var) for (int var = 0; var < array->len; var++)
 
+// Arrays grow on the heap through realloc by default. Set .arena before the first add to grow
+// in an arena instead, which extends in place while the array is the last thing allocated in it.
+static inline void* ds_realloc(M_Arena* arena, void* ptr, u64 old_size, u64 new_size) {
+    if (arena) return arena_realloc(arena, ptr, old_size, new_size);
+    if (new_size == 0) {
+        free(ptr);
+        return nullptr;
+    }
+    return realloc(ptr, new_size);
+}
+
 #define Array_Prototype(Name, Data)\
 typedef struct Name {\
 u32 cap;\
 u32 len;\
 Data* elems;\
+M_Arena* arena;\
 } Name;\
 void Name##_add(Name* array, Data data);\
+void Name##_add_many(Name* array, Data* data, u32 count);\
+Data* Name##_add_uninit(Name* array, u32 count);\
 Data Name##_remove(Name* array, int idx);\
+Data Name##_remove_swap(Name* array, int idx);\
+void Name##_reserve(Name* array, u32 cap);\
+void Name##_shrink_to_fit(Name* array);\
 void Name##_free(Name* array);
 
 #define Array_Impl(Name, Data)\
-void Name##_add(Name* array, Data data) {\
-if (array->len + 1 > array->cap) {\
-void* prev = array->elems;\
+void Name##_reserve(Name* array, u32 cap) {\
+if (cap <= array->cap) return;\
+array->elems = ds_realloc(array->arena, array->elems, array->cap * sizeof(Data), cap * sizeof(Data));\
+array->cap = cap;\
+}\
+static void Name##_grow(Name* array, u32 count) {\
+if (array->len + count <= array->cap) return;\
 u32 new_cap = DoubleCapacity(array->cap);\
-array->elems = calloc(new_cap, sizeof(Data));\
-memmove(array->elems, prev, array->len * sizeof(Data));\
-array->cap = new_cap;\
-free(prev);\
+if (new_cap < array->len + count) new_cap = array->len + count;\
+Name##_reserve(array, new_cap);\
 }\
+void Name##_add(Name* array, Data data) {\
+if (array->len + 1 > array->cap) Name##_grow(array, 1);\
 array->elems[array->len++] = data;\
 }\
+void Name##_add_many(Name* array, Data* data, u32 count) {\
+Name##_grow(array, count);\
+memcpy(array->elems + array->len, data, count * sizeof(Data));\
+array->len += count;\
+}\
+Data* Name##_add_uninit(Name* array, u32 count) {\
+Name##_grow(array, count);\
+Data* first = array->elems + array->len;\
+array->len += count;\
+return first;\
+}\
 Data Name##_remove(Name* array, int idx) {\
 if (idx >= array->len || idx < 0) return (Data){0};\
 Data value = array->elems[idx];\
@@ -46,65 +83,205 @@ memmove(to, from, sizeof(Data) * (array->len - idx - 1));\
 array->len--;\
 return value;\
 }\
+Data Name##_remove_swap(Name* array, int idx) {\
+if (idx >= array->len || idx < 0) return (Data){0};\
+Data value = array->elems[idx];\
+array->elems[idx] = array->elems[--array->len];\
+return value;\
+}\
+void Name##_shrink_to_fit(Name* array) {\
+if (array->len == array->cap) return;\
+array->elems = ds_realloc(array->arena, array->elems, array->cap * sizeof(Data), array->len * sizeof(Data));\
+array->cap = array->len;\
+if (array->cap == 0) array->elems = nullptr;\
+}\
 void Name##_free(Name* array) {\
+if (array->elems) ds_realloc(array->arena, array->elems, array->cap * sizeof(Data), 0);\
+array->cap = 0;\
+array->len = 0;\
+array->elems = nullptr;\
+}
+
+// Small arrays keep their first N elements inline and only spill to the heap (or .arena) past
+// that, so short-lived arrays cost no allocation. elems points into the struct while inline,
+// so don't copy or move a small array that is in use; pass it by pointer instead.
+#define SmallArray_Prototype(Name, Data, N)\
+typedef struct Name {\
+u32 cap;\
+u32 len;\
+Data* elems;\
+M_Arena* arena;\
+Data inline_elems[N];\
+} Name;\
+void Name##_add(Name* array, Data data);\
+void Name##_add_many(Name* array, Data* data, u32 count);\
+Data* Name##_add_uninit(Name* array, u32 count);\
+Data Name##_remove(Name* array, int idx);\
+Data Name##_remove_swap(Name* array, int idx);\
+void Name##_reserve(Name* array, u32 cap);\
+void Name##_free(Name* array);
+
+#define SmallArray_Impl(Name, Data, N)\
+void Name##_reserve(Name* array, u32 cap) {\
+if (array->cap == 0) {\
+array->elems = array->inline_elems;\
+array->cap = N;\
+}\
+if (cap <= array->cap) return;\
+if (array->elems == array->inline_elems) {\
+array->elems = ds_realloc(array->arena, nullptr, 0, cap * sizeof(Data));\
+memcpy(array->elems, array->inline_elems, array->len * sizeof(Data));\
+} else {\
+array->elems = ds_realloc(array->arena, array->elems, array->cap * sizeof(Data), cap * sizeof(Data));\
+}\
+array->cap = cap;\
+}\
+static void Name##_grow(Name* array, u32 count) {\
+if (array->len + count <= array->cap) return;\
+u32 new_cap = array->cap == 0 ? N : array->cap * 2;\
+if (new_cap < array->len + count) new_cap = array->len + count;\
+Name##_reserve(array, new_cap);\
+}\
+void Name##_add(Name* array, Data data) {\
+if (array->len + 1 > array->cap) Name##_grow(array, 1);\
+array->elems[array->len++] = data;\
+}\
+void Name##_add_many(Name* array, Data* data, u32 count) {\
+Name##_grow(array, count);\
+memcpy(array->elems + array->len, data, count * sizeof(Data));\
+array->len += count;\
+}\
+Data* Name##_add_uninit(Name* array, u32 count) {\
+Name##_grow(array, count);\
+Data* first = array->elems + array->len;\
+array->len += count;\
+return first;\
+}\
+Data Name##_remove(Name* array, int idx) {\
+if (idx >= array->len || idx < 0) return (Data){0};\
+Data value = array->elems[idx];\
+memmove(array->elems + idx, array->elems + idx + 1, sizeof(Data) * (array->len - idx - 1));\
+array->len--;\
+return value;\
+}\
+Data Name##_remove_swap(Name* array, int idx) {\
+if (idx >= array->len || idx < 0) return (Data){0};\
+Data value = array->elems[idx];\
+array->elems[idx] = array->elems[--array->len];\
+return value;\
+}\
+void Name##_free(Name* array) {\
+if (array->elems && array->elems != array->inline_elems) ds_realloc(array->arena, array->elems, array->cap * sizeof(Data), 0);\
 array->cap = 0;\
 array->len = 0;\
-if (array->elems) free(array->elems);\
 array->elems = nullptr;\
 }
 
+// Sets keep their elements dense in elems (so they can be iterated like arrays) and scan them
+// linearly while small. Sets made with Set_ImplHashed also keep an open addressed index of
+// element positions past Set_HashThreshold elements, so add/remove/contains stay O(1).
+// Set_Impl has no hash to index with and always scans. Removal swaps the last element in.
+#define Set_HashThreshold 16
+#define Set_NoHash(elem) 0u
+
+#define Set_Impl(Name, Data, data_equals) Set_ImplEx(Name, Data, data_equals, Set_NoHash, false)
+#define Set_ImplHashed(Name, Data, data_equals, data_hash) Set_ImplEx(Name, Data, data_equals, data_hash, true)
+
 #define Set_Prototype(Name, Data)\
 typedef struct Name {\
 u32 cap;\
 u32 len;\
 Data* elems;\
+u32 index_cap;\
+u32* index;\
 } Name;\
 void Name##_add(Name* array, Data data);\
 Data Name##_remove(Name* array, Data elem);\
+b8 Name##_contains(Name* array, Data elem);\
 void Name##_free(Name* array);
 
-#define Set_Impl(Name, Data, data_equals)\
-void Name##_add(Name* array, Data data) {\
+#define Set_ImplEx(Name, Data, data_equals, data_hash, hashed)\
+static u32* Name##_index_find(Name* array, Data elem) {\
+u32 mask = array->index_cap - 1;\
+u32 slot = (u32) data_hash(elem) & mask;\
+while (array->index[slot]) {\
+if (data_equals(array->elems[array->index[slot] - 1], elem)) return &array->index[slot];\
+slot = (slot + 1) & mask;\
+}\
+return &array->index[slot];\
+}\
+static void Name##_index_rebuild(Name* array, u32 index_cap) {\
+free(array->index);\
+array->index_cap = index_cap;\
+array->index = calloc(index_cap, sizeof(u32));\
+for (u32 k = 0; k < array->len; k++)\
+*Name##_index_find(array, array->elems[k]) = k + 1;\
+}\
+static void Name##_index_delete(Name* array, u32* hole) {\
+u32 mask = array->index_cap - 1;\
+u32 i = (u32) (hole - array->index);\
+u32 j = i;\
+while (true) {\
+j = (j + 1) & mask;\
+if (!array->index[j]) break;\
+u32 home = (u32) data_hash(array->elems[array->index[j] - 1]) & mask;\
+if (((j - home) & mask) >= ((j - i) & mask)) {\
+array->index[i] = array->index[j];\
+i = j;\
+}\
+}\
+array->index[i] = 0;\
+}\
+static i64 Name##_find(Name* array, Data elem) {\
+if (array->index) {\
+u32 slot = *Name##_index_find(array, elem);\
+return (i64) slot - 1;\
+}\
 for (u32 k = 0; k < array->len; k++) {\
-if (data_equals(array->elems[k], data)) {\
-return;\
+if (data_equals(array->elems[k], elem)) return k;\
+}\
+return -1;\
 }\
+b8 Name##_contains(Name* array, Data elem) {\
+return Name##_find(array, elem) != -1;\
 }\
+void Name##_add(Name* array, Data data) {\
+if (Name##_find(array, data) != -1) return;\
 if (array->len + 1 > array->cap) {\
-void* prev = array->elems;\
 u32 new_cap = DoubleCapacity(array->cap);\
-array->elems = calloc(new_cap, sizeof(Data));\
-memmove(array->elems, prev, array->len * sizeof(Data));\
+array->elems = realloc(array->elems, new_cap * sizeof(Data));\
 array->cap = new_cap;\
-free(prev);\
 }\
 array->elems[array->len++] = data;\
+if (array->index && array->len * 2 <= array->index_cap) {\
+*Name##_index_find(array, data) = array->len;\
+} else if (hashed && array->len > Set_HashThreshold) {\
+u32 index_cap = array->index_cap ? array->index_cap * 2 : Set_HashThreshold * 4;\
+Name##_index_rebuild(array, index_cap);\
+}\
 }\
 Data Name##_remove(Name* array, Data elem) {\
-for (u32 k = 0; k < array->len; k++) {\
-if (data_equals(array->elems[k], elem)) {\
+i64 k = Name##_find(array, elem);\
+if (k == -1) return (Data) {0};\
 Data value = array->elems[k];\
-if (k == array->len - 1) {\
-array->len--;\
-return value;\
+if (array->index) {\
+Name##_index_delete(array, Name##_index_find(array, elem));\
+if (k != array->len - 1)\
+*Name##_index_find(array, array->elems[array->len - 1]) = (u32) k + 1;\
 }\
-Data* from = array->elems + k + 1;\
-Data* to = array->elems + k;\
-memmove(to, from, sizeof(Data) * (array->len - k - 1));\
-array->len--;\
+array->elems[k] = array->elems[--array->len];\
 return value;\
 }\
-}\
-return (Data) {0};\
-}\
 void Name##_free(Name* array) {\
 array->cap = 0;\
 array->len = 0;\
 if (array->elems) free(array->elems);\
 array->elems = nullptr;\
+free(array->index);\
+array->index_cap = 0;\
+array->index = nullptr;\
 }
 
-
 #define Stack_Prototype(Name, Data)\
 typedef struct Name {\
 u32 cap;\
@@ -243,4 +420,938 @@ return true;\
 }\
 
 
+//~ Swiss Table
+// Drop-in replacement for HashTable_Prototype/HashTable_Impl: same names and parameters, so
+// switching a table over is just renaming the two macros. Each slot has a control byte
+// (empty, deleted, or the low 7 bits of the hash) and lookups match 16 control bytes at a time,
+// only comparing keys whose tag matches. Tombstone, ValIsNull and ValIsTombstone are unused.
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#  include <emmintrin.h>
+#  define SwissTable_SSE2
+#endif
+
+#define SwissTable_GroupSize 16
+#define SwissTable_Empty ((u8) 0x80)
+#define SwissTable_Deleted ((u8) 0xFE)
+
+// Bit i is set when byte i of the group equals tag
+static inline u32 swiss_group_match(u8* group, u8 tag) {
+#ifdef SwissTable_SSE2
+    __m128i ctrl = _mm_loadu_si128((__m128i*) group);
+    return (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) tag)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < SwissTable_GroupSize; i++) mask |= (u32) (group[i] == tag) << i;
+    return mask;
+#endif
+}
+
+// Bit i is set when byte i of the group is empty or deleted
+static inline u32 swiss_group_match_free(u8* group) {
+#ifdef SwissTable_SSE2
+    return (u32) _mm_movemask_epi8(_mm_loadu_si128((__m128i*) group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < SwissTable_GroupSize; i++) mask |= (u32) (group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+static inline u32 swiss_ctz(u32 mask) {
+#if defined(COMPILER_CL)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+#define SwissTable_Prototype(Name, Key, Value)\
+typedef Key Name##_hash_table_key;\
+typedef Value Name##_hash_table_value;\
+typedef struct Name##_hash_table_entry {\
+Name##_hash_table_key key;\
+Name##_hash_table_value value;\
+} Name##_hash_table_entry;\
+typedef struct Name##_hash_table {\
+u32 cap;\
+u32 len;\
+u32 growth_left;\
+u8* ctrl;\
+Name##_hash_table_entry* elems;\
+} Name##_hash_table;\
+void Name##_hash_table_init(Name##_hash_table* table);\
+void Name##_hash_table_free(Name##_hash_table* table);\
+b8 Name##_hash_table_get(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value* val);\
+b8 Name##_hash_table_set(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value  val);\
+b8 Name##_hash_table_del(Name##_hash_table* table, Name##_hash_table_key key);\
+void Name##_hash_table_add_all(Name##_hash_table* to, Name##_hash_table* from);
+
+#define SwissTable_Impl(Name, KeyIsNull, KeyIsEqual, HashKey, Tombstone, ValIsNull, ValIsTombstone)\
+void Name##_hash_table_init(Name##_hash_table* table) {\
+table->cap = 0;\
+table->len = 0;\
+table->growth_left = 0;\
+table->ctrl = nullptr;\
+table->elems = nullptr;\
+}\
+void Name##_hash_table_free(Name##_hash_table* table) {\
+free(table->ctrl);\
+free(table->elems);\
+Name##_hash_table_init(table);\
+}\
+static Name##_hash_table_entry* Name##_hash_table_find(Name##_hash_table* table, Name##_hash_table_key key, u32 hash) {\
+if (table->cap == 0) return nullptr;\
+u32 group_mask = table->cap / SwissTable_GroupSize - 1;\
+u32 group = (hash >> 7) & group_mask;\
+u8 tag = hash & 0x7F;\
+for (u32 probe = 1;; probe++) {\
+u8* ctrl = table->ctrl + group * SwissTable_GroupSize;\
+for (u32 match = swiss_group_match(ctrl, tag); match; match &= match - 1) {\
+Name##_hash_table_entry* entry = &table->elems[group * SwissTable_GroupSize + swiss_ctz(match)];\
+if (KeyIsEqual(entry->key, key)) return entry;\
+}\
+if (swiss_group_match(ctrl, SwissTable_Empty)) return nullptr;\
+if (probe > group_mask) return nullptr;\
+group = (group + probe) & group_mask;\
+}\
+}\
+static u32 Name##_hash_table_find_free(u8* ctrl_base, u32 cap, u32 hash) {\
+u32 group_mask = cap / SwissTable_GroupSize - 1;\
+u32 group = (hash >> 7) & group_mask;\
+for (u32 probe = 1;; probe++) {\
+u32 match = swiss_group_match_free(ctrl_base + group * SwissTable_GroupSize);\
+if (match) return group * SwissTable_GroupSize + swiss_ctz(match);\
+group = (group + probe) & group_mask;\
+}\
+}\
+static void Name##_hash_table_adjust_cap(Name##_hash_table* table, u32 cap) {\
+u8* ctrl = malloc(cap);\
+memset(ctrl, SwissTable_Empty, cap);\
+Name##_hash_table_entry* entries = malloc(cap * sizeof(Name##_hash_table_entry));\
+for (u32 i = 0; i < table->cap; i++) {\
+if (table->ctrl[i] & 0x80) continue;\
+u32 hash = HashKey(table->elems[i].key);\
+u32 slot = Name##_hash_table_find_free(ctrl, cap, hash);\
+ctrl[slot] = hash & 0x7F;\
+entries[slot] = table->elems[i];\
+}\
+free(table->ctrl);\
+free(table->elems);\
+table->ctrl = ctrl;\
+table->elems = entries;\
+table->cap = cap;\
+table->growth_left = cap - cap / 8 - table->len;\
+}\
+b8 Name##_hash_table_set(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value  val) {\
+u32 hash = HashKey(key);\
+Name##_hash_table_entry* entry = Name##_hash_table_find(table, key, hash);\
+if (entry) {\
+entry->value = val;\
+return false;\
+}\
+if (table->growth_left == 0) {\
+/* Mostly tombstones: rehash at the same size to reclaim them */\
+u32 cap = table->cap == 0 ? SwissTable_GroupSize : table->cap;\
+if (table->len >= cap / 2) cap *= 2;\
+Name##_hash_table_adjust_cap(table, cap);\
+}\
+u32 slot = Name##_hash_table_find_free(table->ctrl, table->cap, hash);\
+if (table->ctrl[slot] == SwissTable_Empty) table->growth_left--;\
+table->ctrl[slot] = hash & 0x7F;\
+table->elems[slot].key = key;\
+table->elems[slot].value = val;\
+table->len++;\
+return true;\
+}\
+void Name##_hash_table_add_all(Name##_hash_table* to, Name##_hash_table* from) {\
+for (u32 i = 0; i < from->cap; i++) {\
+if (from->ctrl[i] & 0x80) continue;\
+Name##_hash_table_set(to, from->elems[i].key, from->elems[i].value);\
+}\
+}\
+b8 Name##_hash_table_get(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value* val) {\
+if (table->len == 0) return false;\
+Name##_hash_table_entry* entry = Name##_hash_table_find(table, key, HashKey(key));\
+if (!entry) return false;\
+if (val != nullptr) *val = entry->value;\
+return true;\
+}\
+b8 Name##_hash_table_del(Name##_hash_table* table, Name##_hash_table_key key) {\
+if (table->len == 0) return false;\
+Name##_hash_table_entry* entry = Name##_hash_table_find(table, key, HashKey(key));\
+if (!entry) return false;\
+u32 slot = (u32) (entry - table->elems);\
+u8* group = table->ctrl + (slot & ~(SwissTable_GroupSize - 1));\
+/* Probes only continue past full groups, so a group that still has an empty slot can take another */\
+if (swiss_group_match(group, SwissTable_Empty)) {\
+table->ctrl[slot] = SwissTable_Empty;\
+table->growth_left++;\
+} else {\
+table->ctrl[slot] = SwissTable_Deleted;\
+}\
+table->len--;\
+return true;\
+}
+
+//~ Robin Hood Table
+// Another drop-in for HashTable_Prototype/HashTable_Impl, meant for big, read-mostly tables.
+// Inserts displace entries closer to their home slot (Robin Hood), which keeps probe lengths short
+// even at high load, deletes shift the following run back instead of leaving tombstones, and each
+// slot caches its key's hash so growing never calls HashKey. Set max_load after init to trade
+// memory for probe length, 0 means RobinHoodTable_DefaultMaxLoad. Values above
+// RobinHoodTable_MaxLoad are clamped to it, since a table that fills up can't insert.
+// Tombstone, ValIsNull and ValIsTombstone are unused.
+
+#define RobinHoodTable_DefaultMaxLoad 0.9f
+#define RobinHoodTable_MaxLoad 0.97f
+
+#define RobinHoodTable_Prototype(Name, Key, Value)\
+typedef Key Name##_hash_table_key;\
+typedef Value Name##_hash_table_value;\
+typedef struct Name##_hash_table_entry {\
+Name##_hash_table_key key;\
+Name##_hash_table_value value;\
+} Name##_hash_table_entry;\
+typedef struct Name##_hash_table {\
+u32 cap;\
+u32 len;\
+f32 max_load;\
+u32* hashes; /* 0 marks an empty slot */\
+Name##_hash_table_entry* elems;\
+} Name##_hash_table;\
+void Name##_hash_table_init(Name##_hash_table* table);\
+void Name##_hash_table_free(Name##_hash_table* table);\
+b8 Name##_hash_table_get(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value* val);\
+b8 Name##_hash_table_set(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value  val);\
+b8 Name##_hash_table_del(Name##_hash_table* table, Name##_hash_table_key key);\
+void Name##_hash_table_add_all(Name##_hash_table* to, Name##_hash_table* from);
+
+#define RobinHoodTable_Impl(Name, KeyIsNull, KeyIsEqual, HashKey, Tombstone, ValIsNull, ValIsTombstone)\
+void Name##_hash_table_init(Name##_hash_table* table) {\
+table->cap = 0;\
+table->len = 0;\
+table->max_load = RobinHoodTable_DefaultMaxLoad;\
+table->hashes = nullptr;\
+table->elems = nullptr;\
+}\
+void Name##_hash_table_free(Name##_hash_table* table) {\
+free(table->hashes);\
+free(table->elems);\
+f32 max_load = table->max_load;\
+Name##_hash_table_init(table);\
+table->max_load = max_load;\
+}\
+static u32 Name##_hash_table_hash(Name##_hash_table_key key) {\
+u32 hash = HashKey(key);\
+return hash ? hash : 1;\
+}\
+static i64 Name##_hash_table_find(Name##_hash_table* table, Name##_hash_table_key key, u32 hash) {\
+if (table->len == 0) return -1;\
+u32 mask = table->cap - 1;\
+u32 slot = hash & mask;\
+for (u32 dist = 0;; dist++) {\
+u32 curr = table->hashes[slot];\
+if (curr == 0) return -1;\
+/* Anything we're looking for would have displaced a resident this close to home */\
+if (((slot - (curr & mask)) & mask) < dist) return -1;\
+if (curr == hash && KeyIsEqual(table->elems[slot].key, key)) return slot;\
+slot = (slot + 1) & mask;\
+}\
+}\
+static void Name##_hash_table_insert_new(Name##_hash_table* table, u32 hash, Name##_hash_table_entry entry) {\
+u32 mask = table->cap - 1;\
+u32 slot = hash & mask;\
+u32 dist = 0;\
+while (table->hashes[slot]) {\
+u32 curr_dist = (slot - (table->hashes[slot] & mask)) & mask;\
+if (curr_dist < dist) {\
+u32 swap_hash = table->hashes[slot];\
+Name##_hash_table_entry swap_entry = table->elems[slot];\
+table->hashes[slot] = hash;\
+table->elems[slot] = entry;\
+hash = swap_hash;\
+entry = swap_entry;\
+dist = curr_dist;\
+}\
+slot = (slot + 1) & mask;\
+dist++;\
+}\
+table->hashes[slot] = hash;\
+table->elems[slot] = entry;\
+}\
+static void Name##_hash_table_adjust_cap(Name##_hash_table* table, u32 cap) {\
+u32* old_hashes = table->hashes;\
+Name##_hash_table_entry* old_elems = table->elems;\
+u32 old_cap = table->cap;\
+table->hashes = calloc(cap, sizeof(u32));\
+table->elems = malloc(cap * sizeof(Name##_hash_table_entry));\
+table->cap = cap;\
+for (u32 i = 0; i < old_cap; i++) {\
+if (old_hashes[i]) Name##_hash_table_insert_new(table, old_hashes[i], old_elems[i]);\
+}\
+free(old_hashes);\
+free(old_elems);\
+}\
+b8 Name##_hash_table_set(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value  val) {\
+u32 hash = Name##_hash_table_hash(key);\
+i64 slot = Name##_hash_table_find(table, key, hash);\
+if (slot != -1) {\
+table->elems[slot].value = val;\
+return false;\
+}\
+f32 max_load = table->max_load > 0 ? Min(table->max_load, RobinHoodTable_MaxLoad) : RobinHoodTable_DefaultMaxLoad;\
+if (table->len + 1 > table->cap * max_load) {\
+u32 cap = DoubleCapacity(table->cap);\
+Name##_hash_table_adjust_cap(table, cap);\
+}\
+Name##_hash_table_insert_new(table, hash, (Name##_hash_table_entry) { key, val });\
+table->len++;\
+return true;\
+}\
+void Name##_hash_table_add_all(Name##_hash_table* to, Name##_hash_table* from) {\
+for (u32 i = 0; i < from->cap; i++) {\
+if (!from->hashes[i]) continue;\
+Name##_hash_table_set(to, from->elems[i].key, from->elems[i].value);\
+}\
+}\
+b8 Name##_hash_table_get(Name##_hash_table* table, Name##_hash_table_key key, Name##_hash_table_value* val) {\
+i64 slot = Name##_hash_table_find(table, key, Name##_hash_table_hash(key));\
+if (slot == -1) return false;\
+if (val != nullptr) *val = table->elems[slot].value;\
+return true;\
+}\
+b8 Name##_hash_table_del(Name##_hash_table* table, Name##_hash_table_key key) {\
+i64 found = Name##_hash_table_find(table, key, Name##_hash_table_hash(key));\
+if (found == -1) return false;\
+u32 mask = table->cap - 1;\
+u32 slot = (u32) found;\
+u32 next = (slot + 1) & mask;\
+while (table->hashes[next] && ((next - (table->hashes[next] & mask)) & mask) != 0) {\
+table->hashes[slot] = table->hashes[next];\
+table->elems[slot] = table->elems[next];\
+slot = next;\
+next = (next + 1) & mask;\
+}\
+table->hashes[slot] = 0;\
+table->len--;\
+return true;\
+}
+
+//~ Slot Map
+// Values are stored densely in elems (iterate them like an array) and referenced through handles
+// that pack a slot index with the slot's generation. Erasing bumps the generation, so stale handles
+// stop resolving instead of aliasing whatever reuses the slot. Handle 0 is never valid.
+// Generations don't wrap: a slot erased SlotMap_MaxGeneration times is retired for good.
+// Like arrays, slot maps use the heap unless .arena is set before the first insert.
+
+typedef u32 SlotMapHandle;
+
+#define SlotMap_IndexBits 20
+#define SlotMap_IndexMask ((1u << SlotMap_IndexBits) - 1)
+#define SlotMap_MaxGeneration ((1u << (32 - SlotMap_IndexBits)) - 1)
+#define SlotMap_NoSlot u32_max
+
+typedef struct SlotMapSlot {
+    u32 generation;
+    u32 index; // Dense index while alive, next free slot while free
+} SlotMapSlot;
+
+#define SlotMap_Prototype(Name, Data)\
+typedef struct Name {\
+u32 cap;\
+u32 len;\
+Data* elems;\
+u32* dense_to_slot;\
+SlotMapSlot* slots;\
+u32 slot_count;\
+u32 slot_cap;\
+u32 free_head;\
+M_Arena* arena;\
+} Name;\
+SlotMapHandle Name##_insert(Name* map, Data data);\
+Data* Name##_get(Name* map, SlotMapHandle handle);\
+b8 Name##_erase(Name* map, SlotMapHandle handle);\
+SlotMapHandle Name##_handle_at(Name* map, u32 dense_index);\
+void Name##_free(Name* map);
+
+#define SlotMap_Impl(Name, Data)\
+SlotMapHandle Name##_insert(Name* map, Data data) {\
+if (map->slot_count == 0 && map->slot_cap == 0) map->free_head = SlotMap_NoSlot;\
+u32 slot = map->free_head;\
+if (slot != SlotMap_NoSlot) {\
+map->free_head = map->slots[slot].index;\
+} else {\
+if (map->slot_count == SlotMap_IndexMask) return 0;\
+if (map->slot_count + 1 > map->slot_cap) {\
+u32 new_cap = DoubleCapacity(map->slot_cap);\
+map->slots = ds_realloc(map->arena, map->slots, map->slot_cap * sizeof(SlotMapSlot), new_cap * sizeof(SlotMapSlot));\
+map->slot_cap = new_cap;\
+}\
+slot = map->slot_count++;\
+map->slots[slot].generation = 1;\
+}\
+if (map->len + 1 > map->cap) {\
+u32 new_cap = DoubleCapacity(map->cap);\
+map->elems = ds_realloc(map->arena, map->elems, map->cap * sizeof(Data), new_cap * sizeof(Data));\
+map->dense_to_slot = ds_realloc(map->arena, map->dense_to_slot, map->cap * sizeof(u32), new_cap * sizeof(u32));\
+map->cap = new_cap;\
+}\
+map->slots[slot].index = map->len;\
+map->elems[map->len] = data;\
+map->dense_to_slot[map->len] = slot;\
+map->len++;\
+return (map->slots[slot].generation << SlotMap_IndexBits) | slot;\
+}\
+static SlotMapSlot* Name##_resolve(Name* map, SlotMapHandle handle) {\
+u32 slot = handle & SlotMap_IndexMask;\
+if (slot >= map->slot_count) return nullptr;\
+/* Generation 0 is a retired slot, and what makes handle 0 never valid */\
+if (map->slots[slot].generation == 0) return nullptr;\
+if (map->slots[slot].generation != handle >> SlotMap_IndexBits) return nullptr;\
+return &map->slots[slot];\
+}\
+Data* Name##_get(Name* map, SlotMapHandle handle) {\
+SlotMapSlot* slot = Name##_resolve(map, handle);\
+return slot ? &map->elems[slot->index] : nullptr;\
+}\
+b8 Name##_erase(Name* map, SlotMapHandle handle) {\
+SlotMapSlot* slot = Name##_resolve(map, handle);\
+if (!slot) return false;\
+u32 dense = slot->index;\
+u32 last = --map->len;\
+map->elems[dense] = map->elems[last];\
+map->dense_to_slot[dense] = map->dense_to_slot[last];\
+map->slots[map->dense_to_slot[dense]].index = dense;\
+if (slot->generation == SlotMap_MaxGeneration) {\
+/* Retired: generation 0 matches no handle and the slot never goes back on the free list */\
+slot->generation = 0;\
+return true;\
+}\
+slot->generation++;\
+slot->index = map->free_head;\
+map->free_head = handle & SlotMap_IndexMask;\
+return true;\
+}\
+SlotMapHandle Name##_handle_at(Name* map, u32 dense_index) {\
+if (dense_index >= map->len) return 0;\
+u32 slot = map->dense_to_slot[dense_index];\
+return (map->slots[slot].generation << SlotMap_IndexBits) | slot;\
+}\
+void Name##_free(Name* map) {\
+if (map->elems) ds_realloc(map->arena, map->elems, map->cap * sizeof(Data), 0);\
+if (map->dense_to_slot) ds_realloc(map->arena, map->dense_to_slot, map->cap * sizeof(u32), 0);\
+if (map->slots) ds_realloc(map->arena, map->slots, map->slot_cap * sizeof(SlotMapSlot), 0);\
+map->cap = 0;\
+map->len = 0;\
+map->elems = nullptr;\
+map->dense_to_slot = nullptr;\
+map->slots = nullptr;\
+map->slot_count = 0;\
+map->slot_cap = 0;\
+map->free_head = SlotMap_NoSlot;\
+}
+
+//~ Concurrent Queues
+// Bounded ring buffers for handing work between threads. Capacity is rounded up to a power of two
+// and fixed at init. Push returns false when full and pop returns false when empty, so callers
+// decide whether to spin, yield or drop. Indices written by different threads sit on separate
+// cache lines so producers and consumers don't invalidate each other's lines on every operation.
+
+static inline u32 ds_round_up_pow2(u32 x) {
+    u32 result = 1;
+    while (result < x) result <<= 1;
+    return result;
+}
+
+// Exactly one producer thread and one consumer thread. Both sides are wait-free: each owns its
+// index and only reloads the other side's index when its cached copy says the ring is full/empty.
+#define SPSCQueue_Prototype(Name, Data)\
+typedef struct Name {\
+Data* elems;\
+M_Arena* arena;\
+u32 cap;\
+u32 mask;\
+u8 pad[CACHE_LINE_SIZE - sizeof(Data*) - sizeof(M_Arena*) - 2 * sizeof(u32)];\
+_Atomic(u32) head;\
+u32 cached_tail;\
+u8 pad_head[CACHE_LINE_SIZE - 2 * sizeof(u32)];\
+_Atomic(u32) tail;\
+u32 cached_head;\
+u8 pad_tail[CACHE_LINE_SIZE - 2 * sizeof(u32)];\
+} Name;\
+void Name##_init(Name* queue, u32 capacity, M_Arena* arena);\
+void Name##_free(Name* queue);\
+b8 Name##_push(Name* queue, Data data);\
+b8 Name##_pop(Name* queue, Data* out);
+
+#define SPSCQueue_Impl(Name, Data)\
+void Name##_init(Name* queue, u32 capacity, M_Arena* arena) {\
+MemoryZeroStruct(queue, *queue);\
+queue->arena = arena;\
+queue->cap = ds_round_up_pow2(capacity);\
+queue->mask = queue->cap - 1;\
+queue->elems = ds_realloc(arena, nullptr, 0, queue->cap * sizeof(Data));\
+atomic_init(&queue->head, 0);\
+atomic_init(&queue->tail, 0);\
+}\
+void Name##_free(Name* queue) {\
+if (queue->elems) ds_realloc(queue->arena, queue->elems, queue->cap * sizeof(Data), 0);\
+queue->elems = nullptr;\
+queue->cap = 0;\
+}\
+b8 Name##_push(Name* queue, Data data) {\
+u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);\
+if (tail - queue->cached_head == queue->cap) {\
+queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);\
+if (tail - queue->cached_head == queue->cap) return false;\
+}\
+queue->elems[tail & queue->mask] = data;\
+atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);\
+return true;\
+}\
+b8 Name##_pop(Name* queue, Data* out) {\
+u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);\
+if (head == queue->cached_tail) {\
+queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);\
+if (head == queue->cached_tail) return false;\
+}\
+*out = queue->elems[head & queue->mask];\
+atomic_store_explicit(&queue->head, head + 1, memory_order_release);\
+return true;\
+}
+
+// Any number of producers and consumers (Vyukov's bounded queue). Every cell carries a sequence
+// number that says whether it is ready to be written or read at a given position, so each side
+// claims a position with a single CAS and no thread ever waits on a lock.
+#define MPMCQueue_Prototype(Name, Data)\
+typedef struct Name##Cell {\
+_Atomic(u32) sequence;\
+Data data;\
+} Name##Cell;\
+typedef struct Name {\
+Name##Cell* cells;\
+M_Arena* arena;\
+u32 cap;\
+u32 mask;\
+u8 pad[CACHE_LINE_SIZE - sizeof(Name##Cell*) - sizeof(M_Arena*) - 2 * sizeof(u32)];\
+_Atomic(u32) enqueue_position;\
+u8 pad_enqueue[CACHE_LINE_SIZE - sizeof(u32)];\
+_Atomic(u32) dequeue_position;\
+u8 pad_dequeue[CACHE_LINE_SIZE - sizeof(u32)];\
+} Name;\
+void Name##_init(Name* queue, u32 capacity, M_Arena* arena);\
+void Name##_free(Name* queue);\
+b8 Name##_push(Name* queue, Data data);\
+b8 Name##_pop(Name* queue, Data* out);
+
+#define MPMCQueue_Impl(Name, Data)\
+void Name##_init(Name* queue, u32 capacity, M_Arena* arena) {\
+MemoryZeroStruct(queue, *queue);\
+queue->arena = arena;\
+queue->cap = ds_round_up_pow2(Max(capacity, 2));\
+queue->mask = queue->cap - 1;\
+queue->cells = ds_realloc(arena, nullptr, 0, queue->cap * sizeof(Name##Cell));\
+for (u32 i = 0; i < queue->cap; i++) atomic_init(&queue->cells[i].sequence, i);\
+atomic_init(&queue->enqueue_position, 0);\
+atomic_init(&queue->dequeue_position, 0);\
+}\
+void Name##_free(Name* queue) {\
+if (queue->cells) ds_realloc(queue->arena, queue->cells, queue->cap * sizeof(Name##Cell), 0);\
+queue->cells = nullptr;\
+queue->cap = 0;\
+}\
+b8 Name##_push(Name* queue, Data data) {\
+u32 position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);\
+Name##Cell* cell;\
+for (;;) {\
+cell = &queue->cells[position & queue->mask];\
+u32 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);\
+i32 diff = (i32) (sequence - position);\
+if (diff == 0) {\
+if (atomic_compare_exchange_weak_explicit(&queue->enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) break;\
+} else if (diff < 0) {\
+return false;\
+} else {\
+position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);\
+}\
+}\
+cell->data = data;\
+atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);\
+return true;\
+}\
+b8 Name##_pop(Name* queue, Data* out) {\
+u32 position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);\
+Name##Cell* cell;\
+for (;;) {\
+cell = &queue->cells[position & queue->mask];\
+u32 sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);\
+i32 diff = (i32) (sequence - (position + 1));\
+if (diff == 0) {\
+if (atomic_compare_exchange_weak_explicit(&queue->dequeue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) break;\
+} else if (diff < 0) {\
+return false;\
+} else {\
+position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);\
+}\
+}\
+*out = cell->data;\
+atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);\
+return true;\
+}
+
+//~ Structure of Arrays
+// Declares a container with one array per field and a shared len/cap, so loops stream only the
+// fields they touch. Fields are given as an X-macro list of (Type, Field) pairs:
+//
+//   #define TransformFields(X) X(vec3, position) X(quat, rotation) X(vec3, scale)
+//   SoA_Prototype(TransformSoA, TransformFields)
+//
+// Every field array starts on a SoA_Alignment boundary so SIMD loads over it can be aligned.
+// All arrays live in one block that is reallocated on growth; with .arena set the block comes
+// from the arena, and the old one is left behind until the arena is reset.
+// Name##Elem is the matching struct of one element, used to add and read whole elements.
+
+#define SoA_Alignment 64
+#define SoA_AlignSize(x) (((x) + SoA_Alignment - 1) & ~((u64) SoA_Alignment - 1))
+
+#define SoA_ElemField(Type, Field) Type Field;
+#define SoA_ArrayField(Type, Field) Type* Field;
+#define SoA_FieldSize(Type, Field) size += SoA_AlignSize((u64) cap * sizeof(Type));
+#define SoA_FieldMove(Type, Field)\
+{\
+Type* moved = (Type*) cursor;\
+if (soa->len) memcpy(moved, soa->Field, soa->len * sizeof(Type));\
+soa->Field = moved;\
+cursor += SoA_AlignSize((u64) cap * sizeof(Type));\
+}
+#define SoA_FieldStore(Type, Field) soa->Field[index] = elem.Field;
+#define SoA_FieldLoad(Type, Field) elem.Field = soa->Field[index];
+#define SoA_FieldSwap(Type, Field) soa->Field[index] = soa->Field[last];
+
+#define SoA_Prototype(Name, Fields)\
+typedef struct Name##Elem {\
+Fields(SoA_ElemField)\
+} Name##Elem;\
+typedef struct Name {\
+u32 cap;\
+u32 len;\
+M_Arena* arena;\
+void* block;\
+Fields(SoA_ArrayField)\
+} Name;\
+void Name##_reserve(Name* soa, u32 cap);\
+u32 Name##_add(Name* soa, Name##Elem elem);\
+u32 Name##_add_uninit(Name* soa);\
+Name##Elem Name##_get(Name* soa, u32 index);\
+void Name##_set(Name* soa, u32 index, Name##Elem elem);\
+void Name##_remove_swap(Name* soa, u32 index);\
+void Name##_free(Name* soa);
+
+#define SoA_Impl(Name, Fields)\
+void Name##_reserve(Name* soa, u32 cap) {\
+if (cap <= soa->cap) return;\
+u64 size = 0;\
+Fields(SoA_FieldSize)\
+u8* cursor;\
+void* block = nullptr;\
+if (soa->arena) {\
+cursor = arena_alloc_aligned(soa->arena, size, SoA_Alignment);\
+} else {\
+block = malloc(size + SoA_Alignment);\
+cursor = (u8*) SoA_AlignSize((u64) block);\
+}\
+Fields(SoA_FieldMove)\
+if (soa->block) free(soa->block);\
+soa->block = block;\
+soa->cap = cap;\
+}\
+u32 Name##_add_uninit(Name* soa) {\
+if (soa->len + 1 > soa->cap) Name##_reserve(soa, DoubleCapacity(soa->cap));\
+return soa->len++;\
+}\
+u32 Name##_add(Name* soa, Name##Elem elem) {\
+u32 index = Name##_add_uninit(soa);\
+Fields(SoA_FieldStore)\
+return index;\
+}\
+Name##Elem Name##_get(Name* soa, u32 index) {\
+Name##Elem elem;\
+Fields(SoA_FieldLoad)\
+return elem;\
+}\
+void Name##_set(Name* soa, u32 index, Name##Elem elem) {\
+Fields(SoA_FieldStore)\
+}\
+void Name##_remove_swap(Name* soa, u32 index) {\
+if (index >= soa->len) return;\
+u32 last = --soa->len;\
+Fields(SoA_FieldSwap)\
+}\
+void Name##_free(Name* soa) {\
+if (soa->block) free(soa->block);\
+M_Arena* arena = soa->arena;\
+MemoryZeroStruct(soa, *soa);\
+soa->arena = arena;\
+}
+
+//~ Sorting
+// Sort_Impl generates a pattern-defeating quicksort (pdqsort) specialised for one type, with
+// the comparator expanded inline instead of called through a pointer like qsort. less(a, b)
+// can be a macro or a static inline function taking two values. Sorting is not stable.
+// Small ranges use insertion sort, ranges that partition badly are shuffled and fall back to
+// heapsort after log2(n) bad partitions, and already sorted runs are detected and left alone.
+//
+//   #define f32_less(a, b) ((a) < (b))
+//   Sort_Impl(F32Sort, f32, f32_less)       ->  F32Sort(floats, count);
+
+#define Sort_InsertionThreshold 24
+#define Sort_NintherThreshold 128
+#define Sort_PartialInsertionLimit 8
+
+#define Sort_Prototype(Name, Data)\
+void Name(Data* elems, u64 count);
+
+#define Sort_Impl(Name, Data, less)\
+static inline void Name##_swap(Data* a, Data* b) {\
+Data tmp = *a;\
+*a = *b;\
+*b = tmp;\
+}\
+static inline void Name##_sort2(Data* a, Data* b) {\
+if (less(*b, *a)) Name##_swap(a, b);\
+}\
+static inline void Name##_sort3(Data* a, Data* b, Data* c) {\
+Name##_sort2(a, b);\
+Name##_sort2(b, c);\
+Name##_sort2(a, b);\
+}\
+static void Name##_insertion(Data* begin, Data* end) {\
+if (begin == end) return;\
+for (Data* cur = begin + 1; cur != end; cur++) {\
+Data* sift = cur;\
+Data* sift_1 = cur - 1;\
+if (less(*sift, *sift_1)) {\
+Data tmp = *sift;\
+do { *sift-- = *sift_1; } while (sift != begin && less(tmp, *--sift_1));\
+*sift = tmp;\
+}\
+}\
+}\
+/* The element before begin must be <= everything in the range, so no bounds check is needed */\
+static void Name##_insertion_unguarded(Data* begin, Data* end) {\
+if (begin == end) return;\
+for (Data* cur = begin + 1; cur != end; cur++) {\
+Data* sift = cur;\
+Data* sift_1 = cur - 1;\
+if (less(*sift, *sift_1)) {\
+Data tmp = *sift;\
+do { *sift-- = *sift_1; } while (less(tmp, *--sift_1));\
+*sift = tmp;\
+}\
+}\
+}\
+/* Insertion sort that gives up once it has moved too many elements */\
+static b8 Name##_insertion_partial(Data* begin, Data* end) {\
+if (begin == end) return true;\
+u64 moved = 0;\
+for (Data* cur = begin + 1; cur != end; cur++) {\
+Data* sift = cur;\
+Data* sift_1 = cur - 1;\
+if (less(*sift, *sift_1)) {\
+Data tmp = *sift;\
+do { *sift-- = *sift_1; } while (sift != begin && less(tmp, *--sift_1));\
+*sift = tmp;\
+moved += cur - sift;\
+}\
+if (moved > Sort_PartialInsertionLimit) return false;\
+}\
+return true;\
+}\
+static void Name##_sift_down(Data* elems, u64 root, u64 count) {\
+for (;;) {\
+u64 child = root * 2 + 1;\
+if (child >= count) return;\
+if (child + 1 < count && less(elems[child], elems[child + 1])) child++;\
+if (!less(elems[root], elems[child])) return;\
+Name##_swap(&elems[root], &elems[child]);\
+root = child;\
+}\
+}\
+static void Name##_heapsort(Data* begin, Data* end) {\
+u64 count = end - begin;\
+for (u64 i = count / 2; i > 0; i--) Name##_sift_down(begin, i - 1, count);\
+for (u64 i = count - 1; i > 0; i--) {\
+Name##_swap(&begin[0], &begin[i]);\
+Name##_sift_down(begin, 0, i);\
+}\
+}\
+/* Partitions around *begin, with elements equal to the pivot going right */\
+static Data* Name##_partition_right(Data* begin, Data* end, b8* already_partitioned) {\
+Data pivot = *begin;\
+Data* first = begin;\
+Data* last = end;\
+while (less(*++first, pivot));\
+if (first - 1 == begin) while (first < last && !less(*--last, pivot));\
+else while (!less(*--last, pivot));\
+*already_partitioned = first >= last;\
+while (first < last) {\
+Name##_swap(first, last);\
+while (less(*++first, pivot));\
+while (!less(*--last, pivot));\
+}\
+Data* pivot_pos = first - 1;\
+*begin = *pivot_pos;\
+*pivot_pos = pivot;\
+return pivot_pos;\
+}\
+/* Partitions around *begin, with elements equal to the pivot going left */\
+static Data* Name##_partition_left(Data* begin, Data* end) {\
+Data pivot = *begin;\
+Data* first = begin;\
+Data* last = end;\
+while (less(pivot, *--last));\
+if (last + 1 == end) while (first < last && !less(pivot, *++first));\
+else while (!less(pivot, *++first));\
+while (first < last) {\
+Name##_swap(first, last);\
+while (less(pivot, *--last));\
+while (!less(pivot, *++first));\
+}\
+Data* pivot_pos = last;\
+*begin = *pivot_pos;\
+*pivot_pos = pivot;\
+return pivot_pos;\
+}\
+static void Name##_loop(Data* begin, Data* end, u32 bad_allowed, b8 leftmost) {\
+for (;;) {\
+u64 size = end - begin;\
+if (size < Sort_InsertionThreshold) {\
+if (leftmost) Name##_insertion(begin, end);\
+else Name##_insertion_unguarded(begin, end);\
+return;\
+}\
+u64 half = size / 2;\
+if (size > Sort_NintherThreshold) {\
+Name##_sort3(begin, begin + half, end - 1);\
+Name##_sort3(begin + 1, begin + (half - 1), end - 2);\
+Name##_sort3(begin + 2, begin + (half + 1), end - 3);\
+Name##_sort3(begin + (half - 1), begin + half, begin + (half + 1));\
+Name##_swap(begin, begin + half);\
+} else {\
+Name##_sort3(begin + half, begin, end - 1);\
+}\
+/* A pivot equal to the element before the range means many equal elements: put them all left */\
+if (!leftmost && !less(*(begin - 1), *begin)) {\
+begin = Name##_partition_left(begin, end) + 1;\
+continue;\
+}\
+b8 already_partitioned;\
+Data* pivot_pos = Name##_partition_right(begin, end, &already_partitioned);\
+u64 left_size = pivot_pos - begin;\
+u64 right_size = end - (pivot_pos + 1);\
+if (left_size < size / 8 || right_size < size / 8) {\
+if (--bad_allowed == 0) {\
+Name##_heapsort(begin, end);\
+return;\
+}\
+if (left_size >= Sort_InsertionThreshold) {\
+Name##_swap(begin, begin + left_size / 4);\
+Name##_swap(pivot_pos - 1, pivot_pos - left_size / 4);\
+if (left_size > Sort_NintherThreshold) {\
+Name##_swap(begin + 1, begin + (left_size / 4 + 1));\
+Name##_swap(begin + 2, begin + (left_size / 4 + 2));\
+Name##_swap(pivot_pos - 2, pivot_pos - (left_size / 4 + 1));\
+Name##_swap(pivot_pos - 3, pivot_pos - (left_size / 4 + 2));\
+}\
+}\
+if (right_size >= Sort_InsertionThreshold) {\
+Name##_swap(pivot_pos + 1, pivot_pos + (1 + right_size / 4));\
+Name##_swap(end - 1, end - right_size / 4);\
+if (right_size > Sort_NintherThreshold) {\
+Name##_swap(pivot_pos + 2, pivot_pos + (2 + right_size / 4));\
+Name##_swap(pivot_pos + 3, pivot_pos + (3 + right_size / 4));\
+Name##_swap(end - 2, end - (1 + right_size / 4));\
+Name##_swap(end - 3, end - (2 + right_size / 4));\
+}\
+}\
+} else if (already_partitioned\
+&& Name##_insertion_partial(begin, pivot_pos)\
+&& Name##_insertion_partial(pivot_pos + 1, end)) {\
+return;\
+}\
+Name##_loop(begin, pivot_pos, bad_allowed, leftmost);\
+begin = pivot_pos + 1;\
+leftmost = false;\
+}\
+}\
+void Name(Data* elems, u64 count) {\
+if (count < 2) return;\
+u32 depth_limit = 0;\
+for (u64 n = count; n > 1; n >>= 1) depth_limit++;\
+Name##_loop(elems, elems + count, depth_limit, true);\
+}
+
+// RadixSort_Impl generates a stable LSD radix sort over an unsigned integer key (u32 or u64)
+// pulled out of each element with key_of(elem). It makes one histogram pass, then one scatter
+// pass per key byte, skipping bytes that are the same in every key. temp must hold count
+// elements; pass nullptr to take it from scratch.
+//
+//   RadixSort_Impl(U32RadixSort, u32, u32, Sort_KeyIdentity)
+//   RadixSort_Impl(PairRadixSort, SortKeyIndex64, u64, Sort_KeyOfPair)
+
+typedef struct SortKeyIndex32 {
+    u32 key;
+    u32 index;
+} SortKeyIndex32;
+
+typedef struct SortKeyIndex64 {
+    u64 key;
+    u32 index;
+} SortKeyIndex64;
+
+#define Sort_KeyIdentity(elem) (elem)
+#define Sort_KeyOfPair(elem) ((elem).key)
+
+#define RadixSort_Prototype(Name, Data)\
+void Name(Data* elems, Data* temp, u64 count);
+
+#define RadixSort_Impl(Name, Data, Key, key_of)\
+void Name(Data* elems, Data* temp, u64 count) {\
+if (count < 2) return;\
+M_Scratch scratch = {0};\
+if (!temp) {\
+scratch = scratch_get(nullptr, 0);\
+temp = arena_alloc_array(scratch.arena, Data, count);\
+}\
+u64 histogram[sizeof(Key)][256] = {0};\
+for (u64 i = 0; i < count; i++) {\
+Key key = key_of(elems[i]);\
+for (u32 d = 0; d < sizeof(Key); d++) histogram[d][(key >> (d * 8)) & 0xFF]++;\
+}\
+Data* from = elems;\
+Data* to = temp;\
+for (u32 d = 0; d < sizeof(Key); d++) {\
+u64* counts = histogram[d];\
+if (counts[(key_of(from[0]) >> (d * 8)) & 0xFF] == count) continue;\
+u64 offset = 0;\
+for (u32 b = 0; b < 256; b++) {\
+u64 c = counts[b];\
+counts[b] = offset;\
+offset += c;\
+}\
+for (u64 i = 0; i < count; i++) {\
+Data elem = from[i];\
+to[counts[(key_of(elem) >> (d * 8)) & 0xFF]++] = elem;\
+}\
+Data* swap = from;\
+from = to;\
+to = swap;\
+}\
+if (from != elems) memcpy(elems, from, count * sizeof(Data));\
+if (scratch.arena) scratch_return(&scratch);\
+}
+
 #endif //DS_H
@@ -1,11 +1,19 @@
 #include "input.h"
+#include "bitset.h"
 #include <string.h>
 #include <stdio.h>
 
+#define I_KeyCount 350
+#define I_ButtonCount 8
+
 typedef struct I_InputState {
     GLFWwindow* window;
-    u8 key_states[350];
-    u8 button_states[8];
+    // One bit per key/button for each event, cleared every frame by I_Reset
+    u64 keys_pressed[Bitset_WordCount(I_KeyCount)];
+    u64 keys_released[Bitset_WordCount(I_KeyCount)];
+    u64 keys_repeated[Bitset_WordCount(I_KeyCount)];
+    u64 buttons_pressed[Bitset_WordCount(I_ButtonCount)];
+    u64 buttons_released[Bitset_WordCount(I_ButtonCount)];
     
     f32 mouse_x;
     f32 mouse_y;
@@ -19,33 +27,33 @@ typedef struct I_InputState {
 static I_InputState _state;
 
 static void I_KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (key < 0 || key >= 350) return;
+    if (key < 0 || key >= I_KeyCount) return;
     
     switch (action) {
         case GLFW_PRESS: {
-            _state.key_states[key] |= 0b00000001;
+            bits_set(_state.keys_pressed, key);
         } break;
         
         case GLFW_RELEASE: {
-            _state.key_states[key] |= 0b00000010;
+            bits_set(_state.keys_released, key);
         } break;
         
         case GLFW_REPEAT: {
-            _state.key_states[key] |= 0b00000100;
+            bits_set(_state.keys_repeated, key);
         } break;
     }
 }
 
 static void I_ButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    if (button < 0 || button >= 8) return;
+    if (button < 0 || button >= I_ButtonCount) return;
     switch (action) {
         case GLFW_PRESS: {
-            _state.button_states[button] |= 0b00000001;
+            bits_set(_state.buttons_pressed, button);
             _state.mouse_recordedx = _state.mouse_x;
             _state.mouse_recordedy = _state.mouse_y;
         } break;
         case GLFW_RELEASE: {
-            _state.button_states[button] |= 0b00000010;
+            bits_set(_state.buttons_released, button);
             _state.mouse_recordedx = _state.mouse_x;
             _state.mouse_recordedy = _state.mouse_y;
         } break;
@@ -74,19 +82,22 @@ b32 I_Init(GLFWwindow* window) {
 }
 
 void I_Reset() {
-    memset(_state.key_states, 0, 350 * sizeof(u8));
-    memset(_state.button_states, 0, 8 * sizeof(u8));
+    MemoryZeroStruct(_state.keys_pressed, _state.keys_pressed);
+    MemoryZeroStruct(_state.keys_released, _state.keys_released);
+    MemoryZeroStruct(_state.keys_repeated, _state.keys_repeated);
+    MemoryZeroStruct(_state.buttons_pressed, _state.buttons_pressed);
+    MemoryZeroStruct(_state.buttons_released, _state.buttons_released);
     _state.mouse_scrollx = 0;
     _state.mouse_scrolly = 0;
 }
 
 b32 I_Key(i32 key) { return glfwGetKey(_state.window, key) != GLFW_RELEASE; }
-b32 I_KeyPressed(i32 key) { return (_state.key_states[key] & 0b00000001) != 0; }
-b32 I_KeyReleased(i32 key) { return (_state.key_states[key] & 0b00000010) != 0; }
-b32 I_KeyHeld(i32 key) { return (_state.key_states[key] & 0b00000100) != 0; }
+b32 I_KeyPressed(i32 key) { return bits_test(_state.keys_pressed, key); }
+b32 I_KeyReleased(i32 key) { return bits_test(_state.keys_released, key); }
+b32 I_KeyHeld(i32 key) { return bits_test(_state.keys_repeated, key); }
 b32 I_Button(i32 button) { return glfwGetMouseButton(_state.window, button) != GLFW_RELEASE; }
-b32 I_ButtonPressed(i32 button) { return (_state.button_states[button] & 0b00000001) != 0; }
-b32 I_ButtonReleased(i32 button) { return (_state.button_states[button] & 0b00000010) != 0; }
+b32 I_ButtonPressed(i32 button) { return bits_test(_state.buttons_pressed, button); }
+b32 I_ButtonReleased(i32 button) { return bits_test(_state.buttons_released, button); }
 f32 I_GetMouseX() { return _state.mouse_x; }
 f32 I_GetMouseY() { return _state.mouse_y; }
 f32 I_GetMouseScrollX() { return _state.mouse_scrollx; }
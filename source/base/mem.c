@@ -3,11 +3,25 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
+
+#if M_ARENA_TRACKING
+// The definitions below would otherwise be rewritten by the tracking macros.
+// Allocations made from inside this file keep whatever site the caller's macro recorded
+#undef arena_alloc
+#undef arena_alloc_aligned
+#undef arena_alloc_zero
+#undef arena_raise
+#undef arena_realloc
+#undef arena_alloc_array_sized
+#undef arena_alloc_array_sized_aligned
+#endif
 
 #ifdef PLATFORM_WIN
 #include <windows.h>
 #elif defined(PLATFORM_LINUX)
 #include <sys/mman.h>
+#include <pthread.h>
 #endif
 
 #define DEFAULT_ALIGNMENT (2 * sizeof(void*))
@@ -41,6 +55,8 @@ static void mem_decommit(void* memory, u64 size) {
 #ifdef PLATFORM_WIN
     VirtualFree(memory, size, MEM_DECOMMIT);
 #elif defined(PLATFORM_LINUX)
+    // mprotect alone keeps the pages resident, so drop them first
+    madvise(memory, size, MADV_DONTNEED);
     mprotect(memory, size, PROT_NONE);
 #endif
 }
@@ -67,51 +83,337 @@ u64 align_forward_u64(u64 ptr, u64 align) {
 	return p;
 }
 
+// Reserves a huge-page aligned range and asks the kernel to back it with transparent huge pages.
+// Windows large pages need a privilege and can't be committed lazily, so there it's a plain reserve.
+static void* mem_reserve_huge(u64 size) {
+#ifdef PLATFORM_WIN
+    return mem_reserve(size);
+#elif defined(PLATFORM_LINUX)
+    u8* raw = mmap(nullptr, size + M_HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (raw == MAP_FAILED) return raw;
+    u8* memory = (u8*) align_forward_u64((u64) raw, M_HUGE_PAGE_SIZE);
+    u64 head = memory - raw;
+    if (head) munmap(raw, head);
+    munmap(memory + size, M_HUGE_PAGE_SIZE - head);
+    madvise(memory, size, MADV_HUGEPAGE);
+    return memory;
+#endif
+}
 
-//~ Arena (No alignment)
 
-void* arena_alloc(M_Arena* arena, u64 size) {
+//~ Arena Tracking
+
+#if M_ARENA_TRACKING
+#define M_ARENA_REPORT_TOP_SITES 8
+
+static struct {
+    atomic_flag lock;
+    M_Arena* first;
+} arena_registry = { ATOMIC_FLAG_INIT, nullptr };
+
+static void arena_registry_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&arena_registry.lock, memory_order_acquire));
+}
+
+static void arena_registry_unlock(void) {
+    atomic_flag_clear_explicit(&arena_registry.lock, memory_order_release);
+}
+
+static void arena_tracking_register(M_Arena* arena) {
+    memset(&arena->tracking, 0, sizeof(arena->tracking));
+    arena->tracking.tag = "untagged";
+    arena_registry_lock();
+    arena->tracking.next = arena_registry.first;
+    if (arena_registry.first) arena_registry.first->tracking.prev = arena;
+    arena_registry.first = arena;
+    arena_registry_unlock();
+}
+
+static void arena_tracking_unregister(M_Arena* arena) {
+    arena_registry_lock();
+    if (arena->tracking.prev) arena->tracking.prev->tracking.next = arena->tracking.next;
+    else arena_registry.first = arena->tracking.next;
+    if (arena->tracking.next) arena->tracking.next->tracking.prev = arena->tracking.prev;
+    arena_registry_unlock();
+}
+
+static void arena_tracking_record(M_Arena* arena, u64 size) {
+    M_ArenaTracking* tracking = &arena->tracking;
+    tracking->alloc_count++;
+    tracking->alloc_bytes += size;
+    tracking->peak_used = Max(tracking->peak_used, arena_get_pos(arena));
+    tracking->peak_committed = Max(tracking->peak_committed, arena->prev_committed + arena->commit_position);
+    
+    const char* file = tracking->site_file ? tracking->site_file : "<untracked>";
+    i32 line = tracking->site_line;
+    tracking->site_file = nullptr;
+    tracking->site_line = 0;
+    
+    u32 index = (u32) (((u64) file >> 4) ^ (u64) line * 2654435761u) % (M_ARENA_TRACKED_SITES - 1);
+    M_ArenaSite* site = &tracking->sites[M_ARENA_TRACKED_SITES - 1];
+    for (u32 probe = 0; probe < M_ARENA_TRACKED_SITES - 1; probe++) {
+        M_ArenaSite* curr = &tracking->sites[index];
+        if (!curr->file || (curr->file == file && curr->line == line)) {
+            site = curr;
+            break;
+        }
+        index = (index + 1) % (M_ARENA_TRACKED_SITES - 1);
+    }
+    if (!site->file) {
+        site->file = site == &tracking->sites[M_ARENA_TRACKED_SITES - 1] ? "<other sites>" : file;
+        site->line = line;
+    }
+    site->count++;
+    site->bytes += size;
+}
+
+void arena_set_tag(M_Arena* arena, const char* tag) {
+    arena->tracking.tag = tag;
+}
+
+void arena_track_site(M_Arena* arena, const char* file, i32 line) {
+    arena->tracking.site_file = file;
+    arena->tracking.site_line = line;
+}
+
+void* arena_alloc_tracked(M_Arena* arena, u64 size, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_alloc(arena, size);
+}
+
+void* arena_alloc_aligned_tracked(M_Arena* arena, u64 size, u64 align, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_alloc_aligned(arena, size, align);
+}
+
+void* arena_alloc_zero_tracked(M_Arena* arena, u64 size, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_alloc_zero(arena, size);
+}
+
+void* arena_raise_tracked(M_Arena* arena, void* ptr, u64 size, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_raise(arena, ptr, size);
+}
+
+void* arena_realloc_tracked(M_Arena* arena, void* ptr, u64 old_size, u64 new_size, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_realloc(arena, ptr, old_size, new_size);
+}
+
+void* arena_alloc_array_sized_tracked(M_Arena* arena, u64 elem_size, u64 count, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_alloc_array_sized(arena, elem_size, count);
+}
+
+void* arena_alloc_array_sized_aligned_tracked(M_Arena* arena, u64 elem_size, u64 count, u64 align, const char* file, i32 line) {
+    arena_track_site(arena, file, line);
+    return arena_alloc_array_sized_aligned(arena, elem_size, count, align);
+}
+
+void arena_report(M_Arena* arena, FILE* out) {
+    M_ArenaTracking* tracking = &arena->tracking;
+    M_ArenaStats stats = arena_get_stats(arena);
+    fprintf(out, "Arena '%s': used %llu, committed %llu, peak used %llu, peak committed %llu, %llu allocations (%llu bytes)\n",
+            tracking->tag, stats.used, stats.committed,
+            tracking->peak_used, tracking->peak_committed, tracking->alloc_count, tracking->alloc_bytes);
+    
+    M_ArenaSite top[M_ARENA_REPORT_TOP_SITES] = {0};
+    for (u32 i = 0; i < M_ARENA_TRACKED_SITES; i++) {
+        M_ArenaSite site = tracking->sites[i];
+        if (!site.file) continue;
+        for (u32 k = 0; k < M_ARENA_REPORT_TOP_SITES; k++) {
+            if (!top[k].file || site.bytes > top[k].bytes) {
+                MemoryCopy(top + k + 1, top + k, (M_ARENA_REPORT_TOP_SITES - k - 1) * sizeof(M_ArenaSite));
+                top[k] = site;
+                break;
+            }
+        }
+    }
+    for (u32 k = 0; k < M_ARENA_REPORT_TOP_SITES && top[k].file; k++)
+        fprintf(out, "    %s:%d  %llu allocations, %llu bytes\n", top[k].file, top[k].line, top[k].count, top[k].bytes);
+    flush;
+}
+
+void M_ArenaReportAll(FILE* out) {
+    arena_registry_lock();
+    for (M_Arena* curr = arena_registry.first; curr; curr = curr->tracking.next)
+        arena_report(curr, out);
+    arena_registry_unlock();
+}
+#endif
+
+//~ Arena
+
+// Snapshot of the previous block, stored at the start of each chained block
+typedef struct M_ArenaBlock {
+    struct M_ArenaBlock* prev;
+    u8* memory;
+    u64 max;
+    u64 alloc_position;
+    u64 commit_position;
+    u64 high_water;
+    u64 base_position;
+} M_ArenaBlock;
+
+static void* arena_reserve(M_Arena* arena, u64 size) {
+    return arena->huge_pages ? mem_reserve_huge(size) : mem_reserve(size);
+}
+
+static void arena_push_block(M_Arena* arena, u64 min_size) {
+    u64 reserve = align_forward_u64(min_size + sizeof(M_ArenaBlock), arena->commit_size);
+    reserve = Max(reserve, arena->reserve_size);
+    
+    M_ArenaBlock snapshot = {
+        arena->prev_block, arena->memory, arena->max, arena->alloc_position,
+        arena->commit_position, arena->high_water, arena->base_position
+    };
+    arena->prev_committed += arena->commit_position;
+    arena->base_position += arena->max;
+    arena->memory = arena_reserve(arena, reserve);
+    arena->max = reserve;
+    
+    // The header is bumped in directly so tracking doesn't charge it to the caller's site
+    u64 header = align_forward_u64(sizeof(M_ArenaBlock), DEFAULT_ALIGNMENT);
+    u64 commit = Min(align_forward_u64(header, arena->commit_size), reserve);
+    mem_commit(arena->memory, commit);
+    arena->commit_position = commit;
+    arena->commit_count++;
+    arena->alloc_position = header;
+    arena->high_water = header;
+    
+    M_ArenaBlock* block = (M_ArenaBlock*) arena->memory;
+    *block = snapshot;
+    arena->prev_block = block;
+}
+
+static void arena_pop_block(M_Arena* arena) {
+    M_ArenaBlock snapshot = *arena->prev_block;
+    mem_release(arena->memory, arena->max);
+    arena->prev_block = snapshot.prev;
+    arena->memory = snapshot.memory;
+    arena->max = snapshot.max;
+    arena->alloc_position = snapshot.alloc_position;
+    arena->commit_position = snapshot.commit_position;
+    arena->high_water = snapshot.high_water;
+    arena->base_position = snapshot.base_position;
+    arena->prev_committed -= snapshot.commit_position;
+}
+
+void* arena_alloc_aligned(M_Arena* arena, u64 size, u64 align) {
     void* memory = 0;
     
-    if (arena->alloc_position + size > arena->commit_position) {
+    u64 base = (u64) arena->memory;
+    u64 start = align_forward_u64(base + arena->alloc_position, align) - base;
+    u64 end = start + size;
+    
+    if (end > arena->max && arena->chained) {
+        arena_push_block(arena, size + align);
+        base = (u64) arena->memory;
+        start = align_forward_u64(base + arena->alloc_position, align) - base;
+        end = start + size;
+    }
+    
+    if (end > arena->commit_position) {
         if (!arena->static_size) {
-            u64 commit_size = size;
+            u64 needed = end - arena->commit_position;
+            u64 commit_size = needed;
+            if (arena->geometric_commit)
+                commit_size = Max(commit_size, arena->commit_position);
             
-            commit_size += M_ARENA_COMMIT_SIZE - 1;
-            commit_size -= commit_size % M_ARENA_COMMIT_SIZE;
+            commit_size += arena->commit_size - 1;
+            commit_size -= commit_size % arena->commit_size;
+            commit_size = Min(commit_size, arena->max - arena->commit_position);
             
-            if (arena->commit_position >= arena->max) {
+            if (commit_size < needed) {
                 assert(0 && "Arena is out of memory");
             } else {
                 mem_commit(arena->memory + arena->commit_position, commit_size);
                 arena->commit_position += commit_size;
+                arena->commit_count++;
             }
         } else {
             assert(0 && "Static-Size Arena is out of memory");
         }
     }
     
-    memory = arena->memory + arena->alloc_position;
-    arena->alloc_position += size;
+    memory = arena->memory + start;
+    arena->alloc_position = end;
+    if (end > arena->high_water) arena->high_water = end;
+#if M_ARENA_TRACKING
+    arena_tracking_record(arena, size);
+#endif
     return memory;
 }
 
+void* arena_alloc(M_Arena* arena, u64 size) {
+    return arena_alloc_aligned(arena, size, DEFAULT_ALIGNMENT);
+}
+
 void* arena_alloc_zero(M_Arena* arena, u64 size) {
     void* result = arena_alloc(arena, size);
     memset(result, 0, size);
     return result;
 }
 
+// Decommits everything past keep (rounded up to the commit granularity)
+static void arena_decommit_above(M_Arena* arena, u64 keep) {
+    if (arena->static_size) return;
+    
+    keep += arena->commit_size - 1;
+    keep -= keep % arena->commit_size;
+    if (keep >= arena->commit_position) return;
+    
+    mem_decommit(arena->memory + keep, arena->commit_position - keep);
+    arena->commit_position = keep;
+}
+
+// Hysteresis: only give memory back once the unused committed tail grows past the threshold,
+// and then keep half of it so an arena that oscillates around one size doesn't thrash
+static void arena_apply_decommit_policy(M_Arena* arena) {
+    if (arena->decommit_threshold == 0) return;
+    if (arena->commit_position - arena->alloc_position <= arena->decommit_threshold) return;
+    arena_decommit_above(arena, arena->alloc_position + arena->decommit_threshold / 2);
+}
+
 void arena_dealloc(M_Arena* arena, u64 size) {
-    if (size > arena->alloc_position)
-        size = arena->alloc_position;
-    arena->alloc_position -= size;
+    u64 pos = arena_get_pos(arena);
+    if (size > pos) size = pos;
+    arena_dealloc_to(arena, pos - size);
 }
 
 void arena_dealloc_to(M_Arena* arena, u64 pos) {
+    // A position at a block boundary belongs to the end of the previous block,
+    // so the current block's header never gets handed out again
+    while (arena->prev_block && pos <= arena->base_position)
+        arena_pop_block(arena);
+    pos -= arena->base_position;
     if (pos > arena->max) pos = arena->max;
-    if (pos < 0) pos = 0;
     arena->alloc_position = pos;
+    arena_apply_decommit_policy(arena);
+}
+
+u64 arena_get_pos(M_Arena* arena) {
+    return arena->base_position + arena->alloc_position;
+}
+
+void arena_trim(M_Arena* arena) {
+    arena_decommit_above(arena, arena->alloc_position);
+    arena->high_water = arena->alloc_position;
+}
+
+void arena_trim_to_high_water(M_Arena* arena) {
+    arena_decommit_above(arena, arena->high_water);
+    arena->high_water = arena->alloc_position;
+}
+
+M_ArenaStats arena_get_stats(M_Arena* arena) {
+    return (M_ArenaStats) {
+        .used = arena_get_pos(arena),
+        .committed = arena->prev_committed + arena->commit_position,
+        .high_water = arena->high_water,
+        .commit_count = arena->commit_count,
+    };
 }
 
 void* arena_raise(M_Arena* arena, void* ptr, u64 size) {
@@ -120,91 +422,666 @@ void* arena_raise(M_Arena* arena, void* ptr, u64 size) {
     return raised;
 }
 
+void* arena_realloc(M_Arena* arena, void* ptr, u64 old_size, u64 new_size) {
+    if (!ptr) return arena_alloc(arena, new_size);
+    
+    u64 start = (u8*) ptr - arena->memory;
+    b8 is_top = (u8*) ptr >= arena->memory && start + old_size == arena->alloc_position;
+    if (is_top && start + new_size <= arena->max) {
+        if (new_size > old_size) arena_alloc_aligned(arena, new_size - old_size, 1);
+        else arena_dealloc(arena, old_size - new_size);
+        return ptr;
+    }
+    
+    if (new_size <= old_size) return ptr;
+    void* moved = arena_alloc(arena, new_size);
+    memcpy(moved, ptr, old_size);
+    return moved;
+}
+
 void* arena_alloc_array_sized(M_Arena* arena, u64 elem_size, u64 count) {
     return arena_alloc(arena, elem_size * count);
 }
 
-void arena_init(M_Arena* arena) {
-    arena->max = M_ARENA_MAX;
-    arena->memory = mem_reserve(arena->max);
+void* arena_alloc_array_sized_aligned(M_Arena* arena, u64 elem_size, u64 count, u64 align) {
+    return arena_alloc_aligned(arena, elem_size * count, align);
+}
+
+void arena_init_params(M_Arena* arena, M_ArenaParams params) {
+    arena->commit_size = params.commit_size ? params.commit_size : M_ARENA_COMMIT_SIZE;
+    arena->geometric_commit = params.geometric_commit;
+    arena->huge_pages = params.huge_pages;
+    arena->chained = params.chained;
+    // Committing less than a huge page at a time would split them right back up
+    if (arena->huge_pages)
+        arena->commit_size = align_forward_u64(arena->commit_size, M_HUGE_PAGE_SIZE);
+    arena->reserve_size = params.reserve_size ? params.reserve_size : M_ARENA_MAX;
+    arena->reserve_size = align_forward_u64(arena->reserve_size, arena->commit_size);
+    arena->max = arena->reserve_size;
+    arena->memory = arena_reserve(arena, arena->max);
+    arena->prev_block = nullptr;
+    arena->base_position = 0;
+    arena->prev_committed = 0;
     arena->alloc_position = 0;
     arena->commit_position = 0;
+    arena->high_water = 0;
+    arena->commit_count = 0;
+    arena->decommit_threshold = Max(M_ARENA_DECOMMIT_THRESHOLD, arena->commit_size * 2);
     arena->static_size = false;
+#if M_ARENA_TRACKING
+    arena_tracking_register(arena);
+#endif
+}
+
+void arena_init(M_Arena* arena) {
+    arena_init_params(arena, (M_ArenaParams) {0});
+}
+
+void arena_init_sized(M_Arena* arena, u64 reserve_size, b8 chained) {
+    arena_init_params(arena, (M_ArenaParams) { .reserve_size = reserve_size, .chained = chained });
 }
 
 void arena_clear(M_Arena* arena) {
-    arena_dealloc(arena, arena->alloc_position);
+    arena_dealloc_to(arena, 0);
 }
 
 void arena_free(M_Arena* arena) {
+#if M_ARENA_TRACKING
+    arena_tracking_unregister(arena);
+#endif
+    while (arena->prev_block) arena_pop_block(arena);
     mem_release(arena->memory, arena->max);
 }
 
-//~ Scratch
-typedef struct scratch_free_list_node scratch_free_list_node;
-struct scratch_free_list_node {
-    scratch_free_list_node* next;
-    u32 index;
-};
+M_ArenaTemp arena_begin_temp(M_Arena* arena) {
+    return (M_ArenaTemp) { arena, arena_get_pos(arena) };
+}
 
-static struct {
-    M_Arena arena;
-    u32 max_created;
-    scratch_free_list_node* free_list;
-} scratch_context;
+void arena_end_temp(M_ArenaTemp temp) {
+    arena_dealloc_to(temp.arena, temp.pos);
+}
 
-void M_ScratchInit(void) {
-    arena_init(&scratch_context.arena);
+//~ Pool
+
+void pool_init(M_Pool* pool, u64 slot_size) {
+    arena_init(&pool->arena);
+    arena_set_tag(&pool->arena, "pool");
+    slot_size = Max(slot_size, sizeof(M_PoolFreeNode));
+    u64 align = slot_size >= DEFAULT_ALIGNMENT ? DEFAULT_ALIGNMENT : sizeof(void*);
+    pool->slot_size = align_forward_u64(slot_size, align);
+    pool->slot_count = 0;
+    pool->used_count = 0;
+    pool->free_list = nullptr;
 }
 
-void M_ScratchFree(void) {
-    arena_free(&scratch_context.arena);
-}
-
-M_Scratch scratch_get(void) {
-    if (!scratch_context.free_list) {
-        M_Scratch scratch = {0};
-        
-        scratch.index = scratch_context.max_created;
-        void* ptr = arena_alloc(&scratch_context.arena, M_SCRATCH_SIZE);
-        scratch.arena.memory = ptr;
-        scratch.arena.max = M_SCRATCH_SIZE;
-        scratch.arena.alloc_position = 0;
-        scratch.arena.commit_position = M_SCRATCH_SIZE;
-        scratch.arena.static_size = true;
-        
-        scratch_context.max_created++;
-        return scratch;
+void pool_free(M_Pool* pool) {
+    arena_free(&pool->arena);
+    pool->slot_count = 0;
+    pool->used_count = 0;
+    pool->free_list = nullptr;
+}
+
+void* pool_alloc(M_Pool* pool) {
+    void* slot;
+    if (pool->free_list) {
+        slot = pool->free_list;
+        pool->free_list = pool->free_list->next;
     } else {
-        M_Scratch scratch = {0};
-        scratch.index = scratch_context.free_list->index;
-        
-        scratch.arena.memory = (u8*) scratch_context.free_list;
-        scratch.arena.max = M_SCRATCH_SIZE;
-        scratch.arena.alloc_position = 0;
-        scratch.arena.commit_position = M_SCRATCH_SIZE;
-        scratch.arena.static_size = true;
-        
-        scratch_context.free_list = scratch_context.free_list->next;
-        return scratch;
+        // Slots are all the same size, so they stay aligned without padding
+        slot = arena_alloc_aligned(&pool->arena, pool->slot_size, 1);
+        pool->slot_count++;
     }
+    pool->used_count++;
+    return slot;
 }
 
-void scratch_reset(M_Scratch* scratch) {
-    scratch->arena.alloc_position = 0;
+void* pool_alloc_zero(M_Pool* pool) {
+    void* result = pool_alloc(pool);
+    memset(result, 0, pool->slot_size);
+    return result;
 }
 
-void scratch_return(M_Scratch* scratch) {
-    scratch_free_list_node* prev_head = scratch_context.free_list;
-    scratch_context.free_list = (scratch_free_list_node*) scratch->arena.memory;
-    scratch_context.free_list->next = prev_head;
-    scratch_context.free_list->index = scratch->index;
+void pool_dealloc(M_Pool* pool, void* slot) {
+    if (!slot) return;
+    assert((u8*) slot >= pool->arena.memory
+           && (u8*) slot < pool->arena.memory + pool->arena.alloc_position
+           && "Slot does not belong to this pool");
+    M_PoolFreeNode* node = (M_PoolFreeNode*) slot;
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pool->used_count--;
 }
 
-M_ArenaTemp arena_begin_temp(M_Arena* arena) {
-    return (M_ArenaTemp) { arena, arena->alloc_position };
+void pool_reset(M_Pool* pool) {
+    arena_clear(&pool->arena);
+    pool->slot_count = 0;
+    pool->used_count = 0;
+    pool->free_list = nullptr;
 }
 
-void arena_end_temp(M_ArenaTemp temp) {
-    arena_dealloc_to(temp.arena, temp.pos);
+M_PoolStats pool_get_stats(M_Pool* pool) {
+    return (M_PoolStats) {
+        .slot_size = pool->slot_size,
+        .slot_count = pool->slot_count,
+        .used_count = pool->used_count,
+        .free_count = pool->slot_count - pool->used_count,
+        .occupancy = pool->slot_count ? (f32) pool->used_count / (f32) pool->slot_count : 0.f,
+    };
+}
+
+//~ TLSF
+
+#define TLSF_BLOCK_FREE 1
+#define TLSF_BLOCK_PREV_FREE 2
+#define TLSF_FLAG_MASK (TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+#define TLSF_HEADER_SIZE offsetof(M_TlsfBlock, next_free)
+#define TLSF_MIN_PAYLOAD (sizeof(M_TlsfBlock) - TLSF_HEADER_SIZE)
+#define TLSF_SMALL_BLOCK_SIZE ((u64) 1 << M_TLSF_FL_SHIFT)
+#define TLSF_MAX_PAYLOAD (((u64) 1 << M_TLSF_FL_MAX) - M_TLSF_ALIGNMENT)
+
+static u32 tlsf_ffs(u32 x) {
+#if defined(COMPILER_CL)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+static u32 tlsf_fls(u64 x) {
+#if defined(COMPILER_CL)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return index;
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+
+static u64 tlsf_block_size(M_TlsfBlock* block) { return block->size & ~(u64) TLSF_FLAG_MASK; }
+static b8  tlsf_block_is_free(M_TlsfBlock* block) { return (block->size & TLSF_BLOCK_FREE) != 0; }
+static b8  tlsf_block_prev_is_free(M_TlsfBlock* block) { return (block->size & TLSF_BLOCK_PREV_FREE) != 0; }
+static void* tlsf_block_payload(M_TlsfBlock* block) { return (u8*) block + TLSF_HEADER_SIZE; }
+static M_TlsfBlock* tlsf_block_from_payload(void* ptr) { return (M_TlsfBlock*) ((u8*) ptr - TLSF_HEADER_SIZE); }
+
+static M_TlsfBlock* tlsf_block_next(M_TlsfBlock* block) {
+    return (M_TlsfBlock*) ((u8*) tlsf_block_payload(block) + tlsf_block_size(block));
+}
+
+static void tlsf_block_set_size(M_TlsfBlock* block, u64 size) {
+    block->size = size | (block->size & TLSF_FLAG_MASK);
+}
+
+// Flags the block free or used, and mirrors that into the next block's prev-free bit
+static void tlsf_block_mark(M_TlsfBlock* block, b8 free) {
+    M_TlsfBlock* next = tlsf_block_next(block);
+    if (free) {
+        block->size |= TLSF_BLOCK_FREE;
+        next->size |= TLSF_BLOCK_PREV_FREE;
+        next->prev_phys = block;
+    } else {
+        block->size &= ~(u64) TLSF_BLOCK_FREE;
+        next->size &= ~(u64) TLSF_BLOCK_PREV_FREE;
+    }
+}
+
+static void tlsf_mapping_insert(u64 size, u32* fl, u32* sl) {
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = (u32) (size / (TLSF_SMALL_BLOCK_SIZE / M_TLSF_SL_COUNT));
+    } else {
+        u32 f = tlsf_fls(size);
+        *sl = (u32) (size >> (f - M_TLSF_SL_COUNT_LOG2)) ^ M_TLSF_SL_COUNT;
+        *fl = f - (M_TLSF_FL_SHIFT - 1);
+    }
+}
+
+// Rounds the request up to the next bin boundary so any block in the found bin is big enough
+static void tlsf_mapping_search(u64 size, u32* fl, u32* sl) {
+    if (size >= TLSF_SMALL_BLOCK_SIZE)
+        size += ((u64) 1 << (tlsf_fls(size) - M_TLSF_SL_COUNT_LOG2)) - 1;
+    tlsf_mapping_insert(size, fl, sl);
+}
+
+static void tlsf_insert_free(M_Tlsf* tlsf, M_TlsfBlock* block) {
+    u32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+    M_TlsfBlock* head = tlsf->free_blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = nullptr;
+    if (head) head->prev_free = block;
+    tlsf->free_blocks[fl][sl] = block;
+    tlsf->fl_bitmap |= 1u << fl;
+    tlsf->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void tlsf_remove_free(M_Tlsf* tlsf, M_TlsfBlock* block) {
+    u32 fl, sl;
+    tlsf_mapping_insert(tlsf_block_size(block), &fl, &sl);
+    if (block->prev_free) block->prev_free->next_free = block->next_free;
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+    if (tlsf->free_blocks[fl][sl] == block) {
+        tlsf->free_blocks[fl][sl] = block->next_free;
+        if (!block->next_free) {
+            tlsf->sl_bitmap[fl] &= ~(1u << sl);
+            if (!tlsf->sl_bitmap[fl]) tlsf->fl_bitmap &= ~(1u << fl);
+        }
+    }
+}
+
+static M_TlsfBlock* tlsf_find_free(M_Tlsf* tlsf, u64 size) {
+    u32 fl, sl;
+    tlsf_mapping_search(size, &fl, &sl);
+    if (fl >= M_TLSF_FL_COUNT) return nullptr;
+    
+    u32 sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        u32 fl_map = fl + 1 < 32 ? tlsf->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) return nullptr;
+        fl = tlsf_ffs(fl_map);
+        sl_map = tlsf->sl_bitmap[fl];
+    }
+    sl = tlsf_ffs(sl_map);
+    return tlsf->free_blocks[fl][sl];
+}
+
+static M_TlsfBlock* tlsf_merge_prev(M_Tlsf* tlsf, M_TlsfBlock* block) {
+    if (!tlsf_block_prev_is_free(block)) return block;
+    M_TlsfBlock* prev = block->prev_phys;
+    tlsf_remove_free(tlsf, prev);
+    tlsf_block_set_size(prev, tlsf_block_size(prev) + TLSF_HEADER_SIZE + tlsf_block_size(block));
+    return prev;
+}
+
+static void tlsf_merge_next(M_Tlsf* tlsf, M_TlsfBlock* block) {
+    M_TlsfBlock* next = tlsf_block_next(block);
+    if (!tlsf_block_is_free(next)) return;
+    tlsf_remove_free(tlsf, next);
+    tlsf_block_set_size(block, tlsf_block_size(block) + TLSF_HEADER_SIZE + tlsf_block_size(next));
+}
+
+// Splits the tail off a used block and frees it, if the tail can hold a block of its own
+static void tlsf_trim_used(M_Tlsf* tlsf, M_TlsfBlock* block, u64 size) {
+    u64 block_size = tlsf_block_size(block);
+    if (block_size < size + TLSF_HEADER_SIZE + TLSF_MIN_PAYLOAD) return;
+    
+    tlsf_block_set_size(block, size);
+    M_TlsfBlock* rest = tlsf_block_next(block);
+    rest->size = 0;
+    rest->prev_phys = block;
+    tlsf_block_set_size(rest, block_size - size - TLSF_HEADER_SIZE);
+    
+    tlsf_merge_next(tlsf, rest);
+    tlsf_block_mark(rest, true);
+    tlsf_insert_free(tlsf, rest);
+}
+
+// The old sentinel becomes the header of a new free block, and a new sentinel goes at the end
+static b8 tlsf_grow(M_Tlsf* tlsf, u64 size) {
+    // Big enough to land in a bin that tlsf_mapping_search will look at for this size
+    if (size >= TLSF_SMALL_BLOCK_SIZE)
+        size += (u64) 1 << (tlsf_fls(size) - M_TLSF_SL_COUNT_LOG2);
+    u64 grow = Max(size, M_TLSF_GROW_SIZE);
+    if (tlsf->arena.commit_position + grow + TLSF_HEADER_SIZE > tlsf->arena.max) return false;
+    arena_alloc_aligned(&tlsf->arena, grow + TLSF_HEADER_SIZE, 1);
+    
+    M_TlsfBlock* block = tlsf->sentinel;
+    tlsf_block_set_size(block, grow);
+    M_TlsfBlock* sentinel = tlsf_block_next(block);
+    sentinel->size = 0;
+    sentinel->prev_phys = block;
+    tlsf->sentinel = sentinel;
+    
+    block = tlsf_merge_prev(tlsf, block);
+    tlsf_block_mark(block, true);
+    tlsf_insert_free(tlsf, block);
+    return true;
+}
+
+static u64 tlsf_adjust_size(u64 size) {
+    size = align_forward_u64(size, M_TLSF_ALIGNMENT);
+    return Max(size, TLSF_MIN_PAYLOAD);
+}
+
+void tlsf_init(M_Tlsf* tlsf) {
+    MemoryZeroStruct(tlsf, *tlsf);
+    arena_init(&tlsf->arena);
+    arena_set_tag(&tlsf->arena, "tlsf");
+    tlsf->sentinel = arena_alloc_aligned(&tlsf->arena, TLSF_HEADER_SIZE, M_TLSF_ALIGNMENT);
+    tlsf->sentinel->prev_phys = nullptr;
+    tlsf->sentinel->size = 0;
+}
+
+void tlsf_free(M_Tlsf* tlsf) {
+    arena_free(&tlsf->arena);
+    MemoryZeroStruct(tlsf, *tlsf);
+}
+
+void* tlsf_alloc(M_Tlsf* tlsf, u64 size) {
+    if (size > TLSF_MAX_PAYLOAD) return nullptr;
+    size = tlsf_adjust_size(size);
+    
+    M_TlsfBlock* block = tlsf_find_free(tlsf, size);
+    if (!block) {
+        if (!tlsf_grow(tlsf, size)) return nullptr;
+        block = tlsf_find_free(tlsf, size);
+        if (!block) return nullptr;
+    }
+    
+    tlsf_remove_free(tlsf, block);
+    tlsf_block_mark(block, false);
+    tlsf_trim_used(tlsf, block, size);
+    
+    tlsf->used_bytes += tlsf_block_size(block);
+    tlsf->used_count++;
+    return tlsf_block_payload(block);
+}
+
+void tlsf_dealloc(M_Tlsf* tlsf, void* ptr) {
+    if (!ptr) return;
+    M_TlsfBlock* block = tlsf_block_from_payload(ptr);
+    assert(!tlsf_block_is_free(block) && "Double free in tlsf_dealloc");
+    
+    tlsf->used_bytes -= tlsf_block_size(block);
+    tlsf->used_count--;
+    
+    block = tlsf_merge_prev(tlsf, block);
+    tlsf_merge_next(tlsf, block);
+    tlsf_block_mark(block, true);
+    tlsf_insert_free(tlsf, block);
+}
+
+void* tlsf_realloc(M_Tlsf* tlsf, void* ptr, u64 size) {
+    if (!ptr) return tlsf_alloc(tlsf, size);
+    if (size == 0) {
+        tlsf_dealloc(tlsf, ptr);
+        return nullptr;
+    }
+    if (size > TLSF_MAX_PAYLOAD) return nullptr;
+    
+    M_TlsfBlock* block = tlsf_block_from_payload(ptr);
+    u64 old_size = tlsf_block_size(block);
+    size = tlsf_adjust_size(size);
+    
+    // Grow in place by absorbing a free neighbour when possible
+    M_TlsfBlock* next = tlsf_block_next(block);
+    if (size > old_size && tlsf_block_is_free(next)
+        && old_size + TLSF_HEADER_SIZE + tlsf_block_size(next) >= size) {
+        tlsf_remove_free(tlsf, next);
+        tlsf_block_set_size(block, old_size + TLSF_HEADER_SIZE + tlsf_block_size(next));
+        tlsf_block_mark(block, false);
+    }
+    
+    if (tlsf_block_size(block) >= size) {
+        tlsf_trim_used(tlsf, block, size);
+        tlsf->used_bytes += tlsf_block_size(block);
+        tlsf->used_bytes -= old_size;
+        return ptr;
+    }
+    
+    void* moved = tlsf_alloc(tlsf, size);
+    if (!moved) return nullptr;
+    memcpy(moved, ptr, old_size);
+    tlsf_dealloc(tlsf, ptr);
+    return moved;
+}
+
+M_TlsfStats tlsf_get_stats(M_Tlsf* tlsf) {
+    M_TlsfStats stats = {0};
+    stats.used_bytes = tlsf->used_bytes;
+    stats.used_count = tlsf->used_count;
+    stats.committed = tlsf->arena.commit_position;
+    for (u32 fl = 0; fl < M_TLSF_FL_COUNT; fl++) {
+        for (u32 sl = 0; sl < M_TLSF_SL_COUNT; sl++) {
+            for (M_TlsfBlock* curr = tlsf->free_blocks[fl][sl]; curr; curr = curr->next_free) {
+                u64 size = tlsf_block_size(curr);
+                stats.free_bytes += size;
+                stats.free_count++;
+                stats.largest_free = Max(stats.largest_free, size);
+            }
+        }
+    }
+    if (stats.free_bytes)
+        stats.fragmentation = 1.f - (f32) stats.largest_free / (f32) stats.free_bytes;
+    return stats;
+}
+
+//~ Concurrent Arena
+
+typedef struct M_ConcurrentChunk {
+    M_ConcurrentArena* arena;
+    u64 id;
+    u64 pos;
+    u64 end;
+} M_ConcurrentChunk;
+
+static thread_var M_ConcurrentChunk concurrent_chunks[M_CONCURRENT_CACHED_ARENAS];
+static thread_var u32 concurrent_chunk_evict;
+static _Atomic(u64) concurrent_arena_next_id = 1;
+
+// Pushes commit_limit to at least end plus the commit-ahead margin. One thread commits at a time;
+// the others return straight away since what they claimed is normally below the limit already
+static void concurrent_arena_commit_ahead(M_ConcurrentArena* arena, u64 end) {
+    if (atomic_flag_test_and_set_explicit(&arena->committing, memory_order_acquire)) return;
+    u64 limit = atomic_load_explicit(&arena->commit_limit, memory_order_relaxed);
+    u64 target = Min(align_forward_u64(end + 2 * M_CONCURRENT_COMMIT_AHEAD, M_ARENA_PAGE_ALIGNMENT), arena->max);
+    if (target > limit) {
+        mem_commit(arena->memory + limit, target - limit);
+        atomic_store_explicit(&arena->commit_limit, target, memory_order_release);
+    }
+    atomic_flag_clear_explicit(&arena->committing, memory_order_release);
+}
+
+// Claims [start, start + size) for the calling thread. Only a claim that outruns the commit-ahead
+// margin (a burst bigger than M_CONCURRENT_COMMIT_AHEAD) commits its own range while another
+// thread is extending the limit. Committing is idempotent on both platforms, so overlap is fine
+static u64 concurrent_arena_claim(M_ConcurrentArena* arena, u64 size) {
+    u64 start = atomic_fetch_add_explicit(&arena->position, size, memory_order_relaxed);
+    u64 end = start + size;
+    if (end > arena->max) {
+        assert(0 && "Concurrent Arena is out of memory");
+        return arena->max;
+    }
+    u64 limit = atomic_load_explicit(&arena->commit_limit, memory_order_acquire);
+    if (end + M_CONCURRENT_COMMIT_AHEAD > limit && limit < arena->max) {
+        concurrent_arena_commit_ahead(arena, end);
+        limit = atomic_load_explicit(&arena->commit_limit, memory_order_acquire);
+        if (end > limit) {
+            u64 commit_start = Max(start, limit);
+            commit_start -= commit_start % M_ARENA_PAGE_ALIGNMENT;
+            mem_commit(arena->memory + commit_start, end - commit_start);
+        }
+    }
+    return start;
+}
+
+void concurrent_arena_init(M_ConcurrentArena* arena, u64 reserve_size) {
+    arena->max = reserve_size ? reserve_size : M_ARENA_MAX;
+    arena->memory = mem_reserve(arena->max);
+    arena->chunk_size = M_CONCURRENT_CHUNK_SIZE;
+    arena->id = atomic_fetch_add(&concurrent_arena_next_id, 1);
+    atomic_store(&arena->commit_limit, 0);
+    atomic_flag_clear(&arena->committing);
+    atomic_store(&arena->position, 0);
+    // The first frame shouldn't start with every worker at the limit
+    concurrent_arena_commit_ahead(arena, 0);
+}
+
+void concurrent_arena_free(M_ConcurrentArena* arena) {
+    mem_release(arena->memory, arena->max);
+    arena->id = 0;
+}
+
+// commit_limit stays where it is, so later frames that use no more than this one never commit
+void concurrent_arena_reset(M_ConcurrentArena* arena) {
+    arena->id = atomic_fetch_add(&concurrent_arena_next_id, 1);
+    atomic_store(&arena->position, 0);
+}
+
+void* concurrent_arena_alloc_aligned(M_ConcurrentArena* arena, u64 size, u64 align) {
+    M_ConcurrentChunk* chunk = nullptr;
+    for (u32 i = 0; i < M_CONCURRENT_CACHED_ARENAS; i++) {
+        if (concurrent_chunks[i].arena == arena) {
+            chunk = &concurrent_chunks[i];
+            break;
+        }
+    }
+    if (!chunk) {
+        chunk = &concurrent_chunks[concurrent_chunk_evict];
+        concurrent_chunk_evict = (concurrent_chunk_evict + 1) % M_CONCURRENT_CACHED_ARENAS;
+        chunk->arena = arena;
+        chunk->id = 0;
+    }
+    
+    if (chunk->id == arena->id) {
+        u64 start = align_forward_u64((u64) arena->memory + chunk->pos, align) - (u64) arena->memory;
+        if (start + size <= chunk->end) {
+            chunk->pos = start + size;
+            return arena->memory + start;
+        }
+    }
+    
+    // Big allocations get a claim of their own rather than wasting most of a chunk
+    if (size + align > arena->chunk_size / 2) {
+        u64 start = concurrent_arena_claim(arena, size + align);
+        u64 aligned = align_forward_u64((u64) arena->memory + start, align);
+        return (void*) aligned;
+    }
+    
+    u64 start = concurrent_arena_claim(arena, arena->chunk_size);
+    chunk->id = arena->id;
+    chunk->end = start + arena->chunk_size;
+    chunk->pos = align_forward_u64((u64) arena->memory + start, align) - (u64) arena->memory;
+    void* memory = arena->memory + chunk->pos;
+    chunk->pos += size;
+    return memory;
+}
+
+void* concurrent_arena_alloc(M_ConcurrentArena* arena, u64 size) {
+    return concurrent_arena_alloc_aligned(arena, size, DEFAULT_ALIGNMENT);
+}
+
+u64 concurrent_arena_get_used(M_ConcurrentArena* arena) {
+    return Min(atomic_load(&arena->position), arena->max);
+}
+
+//~ Frame Arenas
+
+void frame_arenas_init(M_FrameArenas* frames, u32 frames_in_flight) {
+    assert(frames_in_flight > 0 && frames_in_flight <= M_FRAMES_IN_FLIGHT_MAX);
+    frames->count = frames_in_flight;
+    frames->current = 0;
+    for (u32 i = 0; i < frames->count; i++) {
+        arena_init_sized(&frames->arenas[i], M_FRAME_ARENA_RESERVE_SIZE, true);
+        arena_set_tag(&frames->arenas[i], "frame");
+    }
+}
+
+void frame_arenas_free(M_FrameArenas* frames) {
+    for (u32 i = 0; i < frames->count; i++)
+        arena_free(&frames->arenas[i]);
+    frames->count = 0;
+}
+
+M_Arena* frame_arenas_begin(M_FrameArenas* frames, u64 frame_index) {
+    frames->current = frame_index % frames->count;
+    M_Arena* arena = &frames->arenas[frames->current];
+    arena_clear(arena);
+    return arena;
+}
+
+M_Arena* frame_arenas_get(M_FrameArenas* frames) {
+    return &frames->arenas[frames->current];
+}
+
+//~ Scratch
+
+typedef struct M_ScratchContext {
+    M_Arena arenas[M_SCRATCH_COUNT];
+    b8 initialized;
+} M_ScratchContext;
+
+static thread_var M_ScratchContext scratch_context;
+
+// Threads that never call M_ScratchFree still release their arenas (and unregister them from
+// tracking) on exit, through a thread-local key whose destructor runs on the exiting thread.
+#ifdef PLATFORM_WIN
+static DWORD scratch_exit_key = FLS_OUT_OF_INDEXES;
+static INIT_ONCE scratch_exit_once = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI scratch_on_thread_exit(PVOID value) {
+    if (value) M_ScratchFree();
+}
+
+static BOOL CALLBACK scratch_create_exit_key(PINIT_ONCE once, PVOID param, PVOID* context) {
+    scratch_exit_key = FlsAlloc(scratch_on_thread_exit);
+    return TRUE;
+}
+
+static void scratch_arm_exit_hook(b8 armed) {
+    InitOnceExecuteOnce(&scratch_exit_once, scratch_create_exit_key, nullptr, nullptr);
+    if (scratch_exit_key != FLS_OUT_OF_INDEXES) FlsSetValue(scratch_exit_key, armed ? &scratch_context : nullptr);
+}
+#elif defined(PLATFORM_LINUX)
+static pthread_key_t scratch_exit_key;
+static pthread_once_t scratch_exit_once = PTHREAD_ONCE_INIT;
+
+static void scratch_on_thread_exit(void* value) {
+    M_ScratchFree();
+}
+
+static void scratch_create_exit_key(void) {
+    pthread_key_create(&scratch_exit_key, scratch_on_thread_exit);
+}
+
+static void scratch_arm_exit_hook(b8 armed) {
+    pthread_once(&scratch_exit_once, scratch_create_exit_key);
+    pthread_setspecific(scratch_exit_key, armed ? &scratch_context : nullptr);
+}
+#endif
+
+void M_ScratchInit(void) {
+    if (scratch_context.initialized) return;
+    for (u32 i = 0; i < M_SCRATCH_COUNT; i++) {
+        arena_init_sized(&scratch_context.arenas[i], M_SCRATCH_RESERVE_SIZE, true);
+        arena_set_tag(&scratch_context.arenas[i], "scratch");
+    }
+    scratch_context.initialized = true;
+    scratch_arm_exit_hook(true);
+}
+
+void M_ScratchFree(void) {
+    if (!scratch_context.initialized) return;
+    for (u32 i = 0; i < M_SCRATCH_COUNT; i++)
+        arena_free(&scratch_context.arenas[i]);
+    scratch_context.initialized = false;
+    scratch_arm_exit_hook(false);
+}
+
+M_Scratch scratch_get(M_Arena** conflicts, u32 conflict_count) {
+    if (!scratch_context.initialized) M_ScratchInit();
+    
+    for (u32 i = 0; i < M_SCRATCH_COUNT; i++) {
+        M_Arena* arena = &scratch_context.arenas[i];
+        b8 is_conflicting = false;
+        for (u32 k = 0; k < conflict_count; k++) {
+            if (conflicts[k] == arena) {
+                is_conflicting = true;
+                break;
+            }
+        }
+        if (!is_conflicting) return arena_begin_temp(arena);
+    }
+    
+    assert(0 && "Every scratch arena is in the conflict list");
+    return (M_Scratch) {0};
+}
+
+void scratch_reset(M_Scratch* scratch) {
+    arena_dealloc_to(scratch->arena, scratch->pos);
+}
+
+void scratch_return(M_Scratch* scratch) {
+    arena_end_temp(*scratch);
 }
@@ -4,51 +4,156 @@
 #define MEM_H
 
 #include <stdlib.h>
+#include <stdatomic.h>
 #include "defines.h"
 
 //~ Arena (Linear Allocator)
 
+// Build with -DM_ARENA_TRACKING=1 to tag arenas and record their allocation sites.
+// With it off the tracking fields, calls and macros below all compile away.
+#ifndef M_ARENA_TRACKING
+#  define M_ARENA_TRACKING 0
+#endif
+
+#if M_ARENA_TRACKING
+#define M_ARENA_TRACKED_SITES 64
+
+typedef struct M_ArenaSite {
+    const char* file;
+    i32 line;
+    u64 count;
+    u64 bytes;
+} M_ArenaSite;
+
+typedef struct M_ArenaTracking {
+    const char* tag;
+    u64 alloc_count;
+    u64 alloc_bytes;
+    u64 peak_used;
+    u64 peak_committed;
+    
+    // Set by the allocation macros right before calling into the arena
+    const char* site_file;
+    i32 site_line;
+    // Open addressed on (file, line). The last slot collects sites that didn't fit
+    M_ArenaSite sites[M_ARENA_TRACKED_SITES];
+    
+    struct M_Arena* prev;
+    struct M_Arena* next;
+} M_ArenaTracking;
+#endif
+
 typedef struct M_Arena {
+    // Current block. Chained arenas keep the blocks before it in prev_block
     u8* memory;
     u64 max;
     u64 alloc_position;
     u64 commit_position;
+    u64 commit_size;        // Commit granularity
+    u64 commit_count;
+    u64 high_water;         // Largest alloc_position since the last trim
+    u64 decommit_threshold; // Unused committed bytes tolerated before rewinding decommits. 0 disables
+    u64 reserve_size;       // Reservation for each block
+    u64 base_position;      // Position of the current block's start, summed over previous blocks
+    u64 prev_committed;     // Committed bytes in previous blocks
+    struct M_ArenaBlock* prev_block;
+    b8 geometric_commit;
+    b8 huge_pages;
+    b8 chained;
     b8 static_size;
+#if M_ARENA_TRACKING
+    M_ArenaTracking tracking;
+#endif
 } M_Arena;
 
+// Zero-initialized params give the arena_init defaults
+typedef struct M_ArenaParams {
+    u64 reserve_size;    // Address space reserved per block. 0 means M_ARENA_MAX
+    b8 chained;          // Reserve another block when full instead of running out of memory
+    u64 commit_size;     // Minimum bytes committed at once. 0 means M_ARENA_COMMIT_SIZE
+    b8 geometric_commit; // Each commit is at least as big as everything committed so far
+    b8 huge_pages;       // Back the arena with transparent huge pages (Linux only)
+} M_ArenaParams;
+
+typedef struct M_ArenaStats {
+    u64 used;
+    u64 committed;
+    u64 high_water;
+    u64 commit_count;
+} M_ArenaStats;
+
 #define M_ARENA_MAX Gigabytes(1)
 #define M_ARENA_COMMIT_SIZE Kilobytes(8)
+#define M_ARENA_PAGE_ALIGNMENT Kilobytes(4)
+#define M_HUGE_PAGE_SIZE Megabytes(2)
+#define M_ARENA_DECOMMIT_THRESHOLD Megabytes(4)
 
+// arena_alloc aligns to 2 * sizeof(void*). Use the aligned variants for SIMD loads (16/32/64)
+// or page-aligned staging data (M_ARENA_PAGE_ALIGNMENT). align must be a power of two.
 void* arena_alloc(M_Arena* arena, u64 size);
+void* arena_alloc_aligned(M_Arena* arena, u64 size, u64 align);
 void* arena_alloc_zero(M_Arena* arena, u64 size);
 void  arena_dealloc(M_Arena* arena, u64 size);
 void  arena_dealloc_to(M_Arena* arena, u64 pos);
+u64   arena_get_pos(M_Arena* arena); // Positions stay valid across chained blocks
 void* arena_raise(M_Arena* arena, void* ptr, u64 size);
+// Grows or shrinks in place when ptr is the last allocation in the arena, otherwise copies
+void* arena_realloc(M_Arena* arena, void* ptr, u64 old_size, u64 new_size);
 void* arena_alloc_array_sized(M_Arena* arena, u64 elem_size, u64 count);
+void* arena_alloc_array_sized_aligned(M_Arena* arena, u64 elem_size, u64 count, u64 align);
 
 #define arena_alloc_array(arena, elem_type, count) \
 arena_alloc_array_sized(arena, sizeof(elem_type), count)
+#define arena_alloc_array_aligned(arena, elem_type, count, align) \
+arena_alloc_array_sized_aligned(arena, sizeof(elem_type), count, align)
 
 void arena_init(M_Arena* arena);
+void arena_init_params(M_Arena* arena, M_ArenaParams params);
+void arena_init_sized(M_Arena* arena, u64 reserve_size, b8 chained);
 void arena_clear(M_Arena* arena);
 void arena_free(M_Arena* arena);
 
-//~ Scratch Helpers
-// A scratch block is just a view into an arena
-
-typedef struct M_Scratch {
-    M_Arena arena;
-    u32 index;
-} M_Scratch;
+// arena_trim gives back everything committed past the current position.
+// arena_trim_to_high_water gives back everything past the peak since the last trim,
+// call it at a steady cadence (e.g. once per frame) so one-off spikes get released.
+void arena_trim(M_Arena* arena);
+void arena_trim_to_high_water(M_Arena* arena);
+M_ArenaStats arena_get_stats(M_Arena* arena);
 
-#define M_SCRATCH_SIZE Kilobytes(128)
+#if M_ARENA_TRACKING
+void arena_set_tag(M_Arena* arena, const char* tag);
+void arena_track_site(M_Arena* arena, const char* file, i32 line);
+void arena_report(M_Arena* arena, FILE* out);
+void M_ArenaReportAll(FILE* out); // Every live arena, across all threads
 
-void M_ScratchInit(void); // Should be called at the start of your app
-void M_ScratchFree(void); // Should be called at the end of your app
+// Each tracked variant records the site and then allocates, so the arena argument is evaluated once
+void* arena_alloc_tracked(M_Arena* arena, u64 size, const char* file, i32 line);
+void* arena_alloc_aligned_tracked(M_Arena* arena, u64 size, u64 align, const char* file, i32 line);
+void* arena_alloc_zero_tracked(M_Arena* arena, u64 size, const char* file, i32 line);
+void* arena_raise_tracked(M_Arena* arena, void* ptr, u64 size, const char* file, i32 line);
+void* arena_realloc_tracked(M_Arena* arena, void* ptr, u64 old_size, u64 new_size, const char* file, i32 line);
+void* arena_alloc_array_sized_tracked(M_Arena* arena, u64 elem_size, u64 count, const char* file, i32 line);
+void* arena_alloc_array_sized_aligned_tracked(M_Arena* arena, u64 elem_size, u64 count, u64 align, const char* file, i32 line);
 
-M_Scratch scratch_get(void);
-void scratch_reset(M_Scratch* scratch);
-void scratch_return(M_Scratch* scratch);
+#  define arena_alloc(arena, size) \
+arena_alloc_tracked(arena, size, FILE_NAME, __LINE__)
+#  define arena_alloc_aligned(arena, size, align) \
+arena_alloc_aligned_tracked(arena, size, align, FILE_NAME, __LINE__)
+#  define arena_alloc_zero(arena, size) \
+arena_alloc_zero_tracked(arena, size, FILE_NAME, __LINE__)
+#  define arena_raise(arena, ptr, size) \
+arena_raise_tracked(arena, ptr, size, FILE_NAME, __LINE__)
+#  define arena_realloc(arena, ptr, old_size, new_size) \
+arena_realloc_tracked(arena, ptr, old_size, new_size, FILE_NAME, __LINE__)
+#  define arena_alloc_array_sized(arena, elem_size, count) \
+arena_alloc_array_sized_tracked(arena, elem_size, count, FILE_NAME, __LINE__)
+#  define arena_alloc_array_sized_aligned(arena, elem_size, count, align) \
+arena_alloc_array_sized_aligned_tracked(arena, elem_size, count, align, FILE_NAME, __LINE__)
+#else
+#  define arena_set_tag(arena, tag) ((void) 0)
+#  define arena_report(arena, out) ((void) 0)
+#  define M_ArenaReportAll(out) ((void) 0)
+#endif
 
 typedef struct M_ArenaTemp {
     M_Arena* arena;
@@ -58,4 +163,156 @@ typedef struct M_ArenaTemp {
 M_ArenaTemp arena_begin_temp(M_Arena* arena);
 void        arena_end_temp(M_ArenaTemp temp);
 
+//~ Pool (Fixed-size Allocator)
+// Slots are carved from the pool's own arena and recycled through an intrusive free list,
+// so a slot must be at least pointer sized. pool_reset drops every slot at once.
+
+typedef struct M_PoolFreeNode {
+    struct M_PoolFreeNode* next;
+} M_PoolFreeNode;
+
+typedef struct M_Pool {
+    M_Arena arena;
+    u64 slot_size;
+    u64 slot_count; // Slots carved from the arena so far
+    u64 used_count; // Slots currently handed out
+    M_PoolFreeNode* free_list;
+} M_Pool;
+
+typedef struct M_PoolStats {
+    u64 slot_size;
+    u64 slot_count;
+    u64 used_count;
+    u64 free_count;
+    f32 occupancy;
+} M_PoolStats;
+
+void  pool_init(M_Pool* pool, u64 slot_size);
+void  pool_free(M_Pool* pool);
+void* pool_alloc(M_Pool* pool);
+void* pool_alloc_zero(M_Pool* pool);
+void  pool_dealloc(M_Pool* pool, void* slot);
+void  pool_reset(M_Pool* pool);
+M_PoolStats pool_get_stats(M_Pool* pool);
+
+#define pool_init_type(pool, type) pool_init(pool, sizeof(type))
+
+//~ TLSF (General-purpose Allocator)
+// Two-level segregated fit: free blocks are binned by size class (first level = power of two,
+// second level = M_TLSF_SL_COUNT linear steps inside it) and two bitmaps locate a fitting bin,
+// so alloc and dealloc are O(1). Memory comes from the allocator's own arena, which grows on demand.
+// Not thread safe.
+
+#define M_TLSF_ALIGNMENT 16
+#define M_TLSF_SL_COUNT_LOG2 5
+#define M_TLSF_SL_COUNT (1 << M_TLSF_SL_COUNT_LOG2)
+#define M_TLSF_FL_SHIFT (M_TLSF_SL_COUNT_LOG2 + 4)
+#define M_TLSF_FL_MAX 32
+#define M_TLSF_FL_COUNT (M_TLSF_FL_MAX - M_TLSF_FL_SHIFT + 1)
+#define M_TLSF_GROW_SIZE Kilobytes(64)
+
+typedef struct M_TlsfBlock {
+    struct M_TlsfBlock* prev_phys;
+    u64 size; // Payload size, the low bits hold the free/prev-free flags
+    // Only valid while the block is free
+    struct M_TlsfBlock* next_free;
+    struct M_TlsfBlock* prev_free;
+} M_TlsfBlock;
+
+typedef struct M_Tlsf {
+    M_Arena arena;
+    M_TlsfBlock* sentinel; // Zero-sized used block at the end of the arena
+    u32 fl_bitmap;
+    u32 sl_bitmap[M_TLSF_FL_COUNT];
+    M_TlsfBlock* free_blocks[M_TLSF_FL_COUNT][M_TLSF_SL_COUNT];
+    u64 used_bytes;
+    u64 used_count;
+} M_Tlsf;
+
+typedef struct M_TlsfStats {
+    u64 used_bytes;
+    u64 used_count;
+    u64 free_bytes;
+    u64 free_count;
+    u64 largest_free;
+    u64 committed;
+    f32 fragmentation; // 1 - largest_free / free_bytes
+} M_TlsfStats;
+
+void  tlsf_init(M_Tlsf* tlsf);
+void  tlsf_free(M_Tlsf* tlsf);
+void* tlsf_alloc(M_Tlsf* tlsf, u64 size);
+void* tlsf_realloc(M_Tlsf* tlsf, void* ptr, u64 size);
+void  tlsf_dealloc(M_Tlsf* tlsf, void* ptr);
+M_TlsfStats tlsf_get_stats(M_Tlsf* tlsf); // Walks the free lists
+
+//~ Concurrent Arena
+// Bump arena that many threads can allocate from at once. Each thread grabs a chunk with one
+// atomic fetch-add and bumps inside it privately. Memory is committed ahead of the claims in
+// large steps by whichever thread first gets near the committed limit, while the others keep
+// claiming below it, so workers don't queue up on commits. Only concurrent_arena_reset and
+// concurrent_arena_free need every thread to have stopped allocating.
+
+#define M_CONCURRENT_CHUNK_SIZE Kilobytes(64)
+#define M_CONCURRENT_CACHED_ARENAS 4 // Arenas a thread keeps a chunk in at once
+#define M_CONCURRENT_COMMIT_AHEAD Megabytes(4) // Committed past the furthest claim, and at init
+
+typedef struct M_ConcurrentArena {
+    u8* memory;
+    u64 max;
+    u64 chunk_size;
+    u64 id;        // Changes on every reset, so threads drop chunks from before it
+    _Atomic(u64) commit_limit; // Everything below is committed. Never lowered
+    atomic_flag committing;
+    u8 pad[CACHE_LINE_SIZE - 5 * sizeof(u64) - sizeof(atomic_flag)];
+    _Atomic(u64) position;
+    u8 pad_position[CACHE_LINE_SIZE - sizeof(u64)];
+} M_ConcurrentArena;
+
+void  concurrent_arena_init(M_ConcurrentArena* arena, u64 reserve_size);
+void  concurrent_arena_free(M_ConcurrentArena* arena);
+void  concurrent_arena_reset(M_ConcurrentArena* arena);
+void* concurrent_arena_alloc(M_ConcurrentArena* arena, u64 size);
+void* concurrent_arena_alloc_aligned(M_ConcurrentArena* arena, u64 size, u64 align);
+u64   concurrent_arena_get_used(M_ConcurrentArena* arena);
+
+//~ Frame Arenas
+// One arena per frame in flight, picked by frame index. frame_arenas_begin clears the frame's
+// arena, so call it only once the GPU is done with that frame (after its fence wait).
+// Anything allocated during the frame then lives until the same slot comes around again.
+
+#define M_FRAMES_IN_FLIGHT_MAX 4
+#define M_FRAME_ARENA_RESERVE_SIZE Megabytes(256)
+
+typedef struct M_FrameArenas {
+    M_Arena arenas[M_FRAMES_IN_FLIGHT_MAX];
+    u32 count;
+    u32 current;
+} M_FrameArenas;
+
+void frame_arenas_init(M_FrameArenas* frames, u32 frames_in_flight);
+void frame_arenas_free(M_FrameArenas* frames);
+M_Arena* frame_arenas_begin(M_FrameArenas* frames, u64 frame_index);
+M_Arena* frame_arenas_get(M_FrameArenas* frames);
+
+//~ Scratch Helpers
+// A scratch block is just a temp region on one of the calling thread's scratch arenas.
+// Pass the arenas you are still allocating results into as conflicts, so a nested
+// scratch_get never hands back an arena the caller is using.
+
+typedef M_ArenaTemp M_Scratch;
+
+#define M_SCRATCH_COUNT 4
+#define M_SCRATCH_RESERVE_SIZE Megabytes(64)
+
+// Each thread that uses scratch reserves M_SCRATCH_COUNT arenas, lazily on its first scratch_get.
+// They are released when the thread exits, or earlier with M_ScratchFree. The main thread's
+// exit hook doesn't run when main returns, so call M_ScratchFree there.
+void M_ScratchInit(void);
+void M_ScratchFree(void);
+
+M_Scratch scratch_get(M_Arena** conflicts, u32 conflict_count);
+void scratch_reset(M_Scratch* scratch);
+void scratch_return(M_Scratch* scratch);
+
 #endif //MEM_H
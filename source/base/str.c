@@ -1,8 +1,21 @@
 #include "str.h"
+#include "bitset.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <assert.h>
 
+#if defined(COMPILER_CL)
+#  include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define Str_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#  include <emmintrin.h>
+#  define Str_SSE2
+#endif
+
 string_const str_alloc(M_Arena* arena, u64 size) {
     string_const str = {0};
     str.str = (u8*)arena_alloc(arena, size + 1);
@@ -30,16 +43,31 @@ string_const str_cat(M_Arena* arena, string_const a, string_const b) {
     return final;
 }
 
+// Most output fits the stack guess, which costs one vsnprintf and a short copy. Longer output is
+// measured by that same call and formatted again into an exactly sized allocation, so nothing
+// is ever truncated and the arena only ever sees (and tracking only records) the final size.
+#define Str_FormatGuess 256
+
+string_const str_from_formatv(M_Arena* arena, const char* format, va_list args) {
+    char guess[Str_FormatGuess];
+    va_list attempt;
+    va_copy(attempt, args);
+    int written = vsnprintf(guess, Str_FormatGuess, format, attempt);
+    va_end(attempt);
+    assert(written >= 0 && "Invalid format string");
+    
+    string_const str = str_alloc(arena, written);
+    if ((u64) written < Str_FormatGuess) memcpy(str.str, guess, written + 1);
+    else vsnprintf((char*) str.str, written + 1, format, args);
+    return str;
+}
+
 string_const str_from_format(M_Arena* arena, const char* format, ...) {
     va_list args;
     va_start(args, format);
-    char buf[8092];
-    vsnprintf(buf, 8092, format, args);
+    string_const str = str_from_formatv(arena, format, args);
     va_end(args);
-    u64 size = strlen(buf);
-    string_const s = str_alloc(arena, size);
-    memmove(s.str, buf, size);
-    return s;
+    return str;
 }
 
 b8 str_eq(string_const a, string_const b) {
@@ -47,100 +75,516 @@ b8 str_eq(string_const a, string_const b) {
     return memcmp(a.str, b.str, b.size) == 0;
 }
 
+//~ Substring search
+// Short needles are found by comparing the needle's first and last byte against a whole block
+// of candidate positions at once and only running memcmp where both match. Long needles on
+// long haystacks use Boyer-Moore-Horspool, which skips ahead by up to the needle length.
+
+#define Str_HorspoolMinNeedle 32
+#define Str_HorspoolMinHaystack 1024
+
+static u64 str_search_forward(u8* haystack, u64 size, u8* needle, u64 needle_size, u64 start) {
+    u64 last_start = size - needle_size;
+    u64 middle = needle_size > 2 ? needle_size - 2 : 0;
+    u8 first = needle[0];
+    u8 last = needle[needle_size - 1];
+    u64 i = start;
+#if defined(Str_AVX2)
+    __m256i first_v = _mm256_set1_epi8((char) first);
+    __m256i last_v = _mm256_set1_epi8((char) last);
+    for (; i + 32 <= last_start + 1; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((__m256i*) (haystack + i));
+        __m256i block_last = _mm256_loadu_si256((__m256i*) (haystack + i + needle_size - 1));
+        u64 mask = (u32) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_v),
+                                                                _mm256_cmpeq_epi8(block_last, last_v)));
+        for (; mask; mask &= mask - 1) {
+            u64 at = i + bits_ctz64(mask);
+            if (memcmp(haystack + at + 1, needle + 1, middle) == 0) return at;
+        }
+    }
+#endif
+#if defined(Str_SSE2)
+    __m128i first_b = _mm_set1_epi8((char) first);
+    __m128i last_b = _mm_set1_epi8((char) last);
+    for (; i + 16 <= last_start + 1; i += 16) {
+        __m128i block_first = _mm_loadu_si128((__m128i*) (haystack + i));
+        __m128i block_last = _mm_loadu_si128((__m128i*) (haystack + i + needle_size - 1));
+        u64 mask = (u32) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first_b),
+                                                         _mm_cmpeq_epi8(block_last, last_b)));
+        for (; mask; mask &= mask - 1) {
+            u64 at = i + bits_ctz64(mask);
+            if (memcmp(haystack + at + 1, needle + 1, middle) == 0) return at;
+        }
+    }
+#endif
+    for (; i <= last_start; i++) {
+        if (haystack[i] == first && haystack[i + needle_size - 1] == last
+            && memcmp(haystack + i + 1, needle + 1, middle) == 0) return i;
+    }
+    return size;
+}
+
+// Finds the last match starting at or before end, or u64_max
+static u64 str_search_backward(u8* haystack, u64 size, u8* needle, u64 needle_size, u64 end) {
+    u64 middle = needle_size > 2 ? needle_size - 2 : 0;
+    u8 first = needle[0];
+    u8 last = needle[needle_size - 1];
+    u64 remaining = Min(end, size - needle_size) + 1; // Candidates left are [0, remaining)
+#if defined(Str_SSE2)
+    __m128i first_b = _mm_set1_epi8((char) first);
+    __m128i last_b = _mm_set1_epi8((char) last);
+    for (; remaining >= 16; remaining -= 16) {
+        u64 base = remaining - 16;
+        __m128i block_first = _mm_loadu_si128((__m128i*) (haystack + base));
+        __m128i block_last = _mm_loadu_si128((__m128i*) (haystack + base + needle_size - 1));
+        u64 mask = (u32) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first_b),
+                                                         _mm_cmpeq_epi8(block_last, last_b)));
+        while (mask) {
+            u32 bit = bits_msb64(mask);
+            if (memcmp(haystack + base + bit + 1, needle + 1, middle) == 0) return base + bit;
+            mask &= ~(1ull << bit);
+        }
+    }
+#endif
+    while (remaining--) {
+        if (haystack[remaining] == first && haystack[remaining + needle_size - 1] == last
+            && memcmp(haystack + remaining + 1, needle + 1, middle) == 0) return remaining;
+    }
+    return u64_max;
+}
+
+static u64 str_search_horspool(u8* haystack, u64 size, u8* needle, u64 needle_size, u64 start) {
+    u64 skip[256];
+    for (u32 c = 0; c < 256; c++) skip[c] = needle_size;
+    for (u64 k = 0; k + 1 < needle_size; k++) skip[needle[k]] = needle_size - 1 - k;
+    
+    u8 last = needle[needle_size - 1];
+    for (u64 i = start; i <= size - needle_size;) {
+        u8 c = haystack[i + needle_size - 1];
+        if (c == last && memcmp(haystack + i, needle, needle_size - 1) == 0) return i;
+        i += skip[c];
+    }
+    return size;
+}
+
+static u64 str_find_from(string_const str, string_const needle, u64 offset) {
+    if (needle.size == 0) return 0;
+    if (needle.size > str.size || offset > str.size - needle.size) return str.size;
+    if (needle.size == 1) {
+        u8* hit = memchr(str.str + offset, needle.str[0], str.size - offset);
+        return hit ? (u64) (hit - str.str) : str.size;
+    }
+    if (needle.size >= Str_HorspoolMinNeedle && str.size - offset >= Str_HorspoolMinHaystack) {
+        return str_search_horspool(str.str, str.size, needle.str, needle.size, offset);
+    }
+    return str_search_forward(str.str, str.size, needle.str, needle.size, offset);
+}
+
+u64 str_find_first(string_const str, string_const needle, u32 offset) {
+    return str_find_from(str, needle, offset);
+}
+
+u64 str_find_last(string_const str, string_const needle, u32 offset) {
+    if (offset == 0) offset = str.size;
+    if (needle.size == 0 || needle.size > str.size || offset == 0) return 0;
+    u64 found = str_search_backward(str.str, str.size, needle.str, needle.size, offset - 1);
+    return found == u64_max ? 0 : found + 1;
+}
+
+u64 str_substr_count(string_const str, string_const needle) {
+    if (needle.size == 0) return 0;
+    u64 count = 0;
+    for (u64 at = str_find_from(str, needle, 0); at != str.size; at = str_find_from(str, needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+//~ Replacement
+// Matches are found in one left-to-right pass and their offsets recorded in scratch, then the
+// output is sized exactly and built by block-copying the runs between matches.
+
+typedef struct str_match {
+    u64 offset;
+    u32 pattern;
+} str_match;
+
+typedef struct str_match_list {
+    str_match* matches;
+    u64 count;
+    u64 cap;
+} str_match_list;
+
+static void str_match_push(M_Arena* arena, str_match_list* list, u64 offset, u32 pattern) {
+    if (list->count == list->cap) {
+        u64 new_cap = list->cap ? list->cap * 2 : 64;
+        list->matches = arena_realloc(arena, list->matches, list->cap * sizeof(str_match), new_cap * sizeof(str_match));
+        list->cap = new_cap;
+    }
+    list->matches[list->count++] = (str_match) { offset, pattern };
+}
+
+static string_const str_replace_matches(M_Arena* arena, string_const to_fix, str_match_list* list,
+                                        string_const* needles, string_const* replacements) {
+    u64 size = to_fix.size;
+    for (u64 i = 0; i < list->count; i++) {
+        u32 pattern = list->matches[i].pattern;
+        size = size - needles[pattern].size + replacements[pattern].size;
+    }
+    
+    string_const ret = str_alloc(arena, size);
+    u8* out = ret.str;
+    u64 copied = 0;
+    for (u64 i = 0; i < list->count; i++) {
+        str_match match = list->matches[i];
+        memcpy(out, to_fix.str + copied, match.offset - copied);
+        out += match.offset - copied;
+        memcpy(out, replacements[match.pattern].str, replacements[match.pattern].size);
+        out += replacements[match.pattern].size;
+        copied = match.offset + needles[match.pattern].size;
+    }
+    memcpy(out, to_fix.str + copied, to_fix.size - copied);
+    return ret;
+}
+
 string_const str_replace_all(M_Arena* arena, string_const to_fix, string_const needle, string_const replacement) {
     if (needle.size == 0) return to_fix;
-    u64 replaceable = str_substr_count(to_fix, needle);
-    if (replaceable == 0) return to_fix;
+    M_Scratch scratch = scratch_get(&arena, 1);
     
-    u64 new_size = (to_fix.size - replaceable * needle.size) + (replaceable * replacement.size);
-    string_const ret = str_alloc(arena, new_size);
+    str_match_list list = {0};
+    u64 at = str_find_from(to_fix, needle, 0);
+    while (at != to_fix.size) {
+        str_match_push(scratch.arena, &list, at, 0);
+        at = str_find_from(to_fix, needle, at + needle.size);
+    }
+    
+    string_const ret = to_fix;
+    if (list.count) ret = str_replace_matches(arena, to_fix, &list, &needle, &replacement);
+    scratch_return(&scratch);
+    return ret;
+}
+
+string_const str_replace_many(M_Arena* arena, string_const to_fix, string_const* needles, string_const* replacements, u32 count) {
+    assert(count <= 64 && "str_replace_many supports up to 64 patterns");
+    M_Scratch scratch = scratch_get(&arena, 1);
+    
+    // Which patterns can start with each byte, so most positions cost one table lookup
+    u64 starts_with[256] = {0};
+    for (u32 k = 0; k < count; k++) {
+        if (needles[k].size) starts_with[needles[k].str[0]] |= 1ull << k;
+    }
     
-    b8 replaced;
-    u64 o = 0;
+    str_match_list list = {0};
     for (u64 i = 0; i < to_fix.size;) {
-        replaced = false;
-        if (to_fix.str[i] == needle.str[0]) {
-            if ((to_fix.size - i) >= needle.size) {
-                string_const sub = { .str = to_fix.str + i, .size = needle.size };
-                if (str_eq(sub, needle)) {
-                    // replace this one
-                    memmove(ret.str + o, replacement.str, replacement.size);
-                    replaced = true;
-                }
+        u64 candidates = starts_with[to_fix.str[i]];
+        u64 matched = 0;
+        for (; candidates; candidates &= candidates - 1) {
+            u32 k = bits_ctz64(candidates);
+            if (to_fix.size - i >= needles[k].size && memcmp(to_fix.str + i, needles[k].str, needles[k].size) == 0) {
+                str_match_push(scratch.arena, &list, i, k);
+                matched = needles[k].size;
+                break;
             }
         }
-        
-        if (replaced) {
-            o += replacement.size;
-            i += needle.size;
-            continue;
-        }
-        
-        ret.str[o] = to_fix.str[i];
-        o++; i++;
+        i += matched ? matched : 1;
     }
     
+    string_const ret = to_fix;
+    if (list.count) ret = str_replace_matches(arena, to_fix, &list, needles, replacements);
+    scratch_return(&scratch);
     return ret;
 }
 
-u64 str_substr_count(string_const str, string_const needle) {
-    u32 ct = 0;
-    u64 idx = 0;
-    while (true) {
-        idx = str_find_first(str, needle, idx);
-        if (idx == str.size)
-            break;
-        ct++;
-        idx++;
+//~ Hashing
+// wyhash (final version 4). Keys up to 16 bytes take a branch-light path of overlapping reads;
+// longer keys are folded 48 bytes at a time through three independent 64x64->128 multiply
+// lanes. Every output bit depends on every input bit, so the low bits are safe to mask with.
+
+static const u64 str_hash_secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+static inline void str_hash_mum(u64* a, u64* b) {
+#if defined(COMPILER_CL)
+    u64 high;
+    *a = _umul128(*a, *b, &high);
+    *b = high;
+#else
+    __uint128_t r = (__uint128_t) *a * *b;
+    *a = (u64) r;
+    *b = (u64) (r >> 64);
+#endif
+}
+
+static inline u64 str_hash_mix(u64 a, u64 b) {
+    str_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline u64 str_hash_read8(u8* p) { u64 v; memcpy(&v, p, 8); return v; }
+static inline u64 str_hash_read4(u8* p) { u32 v; memcpy(&v, p, 4); return v; }
+static inline u64 str_hash_read3(u8* p, u64 k) { return ((u64) p[0] << 16) | ((u64) p[k >> 1] << 8) | p[k - 1]; }
+
+static inline u64 str_hash_block(u8* p, u64 seed, u64* see1, u64* see2) {
+    *see1 = str_hash_mix(str_hash_read8(p + 16) ^ str_hash_secret[2], str_hash_read8(p + 24) ^ *see1);
+    *see2 = str_hash_mix(str_hash_read8(p + 32) ^ str_hash_secret[3], str_hash_read8(p + 40) ^ *see2);
+    return str_hash_mix(str_hash_read8(p) ^ str_hash_secret[1], str_hash_read8(p + 8) ^ seed);
+}
+
+// Hashes the last 1..48 bytes. p[-16..-1] must be readable when more than 16 bytes came before.
+static inline u64 str_hash_tail(u8* p, u64 remaining, u64 seed, u64 total) {
+    u64 a, b;
+    while (remaining > 16) {
+        seed = str_hash_mix(str_hash_read8(p) ^ str_hash_secret[1], str_hash_read8(p + 8) ^ seed);
+        remaining -= 16;
+        p += 16;
     }
-    return ct;
+    a = str_hash_read8(p + remaining - 16);
+    b = str_hash_read8(p + remaining - 8);
+    a ^= str_hash_secret[1];
+    b ^= seed;
+    str_hash_mum(&a, &b);
+    return str_hash_mix(a ^ str_hash_secret[0] ^ total, b ^ str_hash_secret[1]);
 }
 
-u64 str_find_first(string_const str, string_const needle, u32 offset) {
-    u64 i = 0;
-    if (needle.size > 0) {
-        i = str.size;
-        if (str.size >= needle.size) {
-            i = offset;
-            i8 c = needle.str[0];
-            u64 one_past_last = str.size - needle.size + 1;
-            for (; i < one_past_last; i++) {
-                if (str.str[i] == c) {
-                    if ((str.size - i) >= needle.size) {
-                        string_const sub = { .str = str.str + i, .size = needle.size };
-                        if (str_eq(sub, needle)) break;
-                    }
-                }
-            }
-            if (i == one_past_last) {
-                i = str.size;
+static inline u64 str_hash_short(u8* p, u64 size, u64 seed) {
+    u64 a = 0, b = 0;
+    if (size >= 4) {
+        a = (str_hash_read4(p) << 32) | str_hash_read4(p + ((size >> 3) << 2));
+        b = (str_hash_read4(p + size - 4) << 32) | str_hash_read4(p + size - 4 - ((size >> 3) << 2));
+    } else if (size > 0) {
+        a = str_hash_read3(p, size);
+    }
+    a ^= str_hash_secret[1];
+    b ^= seed;
+    str_hash_mum(&a, &b);
+    return str_hash_mix(a ^ str_hash_secret[0] ^ size, b ^ str_hash_secret[1]);
+}
+
+u64 str_hash_seeded(string_const str, u64 seed) {
+    u8* p = str.str;
+    u64 size = str.size;
+    seed ^= str_hash_mix(seed ^ str_hash_secret[0], str_hash_secret[1]);
+    if (size <= 16) return str_hash_short(p, size, seed);
+    
+    u64 remaining = size;
+    if (remaining > 48) {
+        u64 see1 = seed, see2 = seed;
+        do {
+            seed = str_hash_block(p, seed, &see1, &see2);
+            p += 48;
+            remaining -= 48;
+        } while (remaining > 48);
+        seed ^= see1 ^ see2;
+    }
+    return str_hash_tail(p, remaining, seed, size);
+}
+
+u64 str_hash(string_const str) {
+    return str_hash_seeded(str, 0);
+}
+
+// The streaming hasher holds back up to 48 bytes until it knows more input follows, so it
+// folds exactly the blocks the one-shot hash would and gives the same result. The 16 bytes
+// before the pending ones are kept too, since the final read can reach back into them.
+void str_hasher_init(str_hasher* hasher, u64 seed) {
+    MemoryZeroStruct(hasher, *hasher);
+    hasher->seed = seed ^ str_hash_mix(seed ^ str_hash_secret[0], str_hash_secret[1]);
+    hasher->see1 = hasher->seed;
+    hasher->see2 = hasher->seed;
+}
+
+void str_hasher_update(str_hasher* hasher, string_const data) {
+    u8* p = data.str;
+    u64 size = data.size;
+    hasher->total += size;
+    u8* pending = hasher->buffer + 16;
+    
+    while (size) {
+        if (hasher->pending == 48) {
+            hasher->seed = str_hash_block(pending, hasher->seed, &hasher->see1, &hasher->see2);
+            hasher->blocks = true;
+            memcpy(hasher->buffer, pending + 32, 16);
+            hasher->pending = 0;
+        }
+        if (hasher->pending == 0 && size > 48) {
+            do {
+                hasher->seed = str_hash_block(p, hasher->seed, &hasher->see1, &hasher->see2);
+                p += 48;
+                size -= 48;
+            } while (size > 48);
+            hasher->blocks = true;
+            memcpy(hasher->buffer, p - 16, 16);
+        }
+        u64 take = Min(size, 48 - hasher->pending);
+        memcpy(pending + hasher->pending, p, take);
+        hasher->pending += take;
+        p += take;
+        size -= take;
+    }
+}
+
+u64 str_hasher_final(str_hasher* hasher) {
+    u8* pending = hasher->buffer + 16;
+    if (hasher->total <= 16) return str_hash_short(pending, hasher->total, hasher->seed);
+    u64 seed = hasher->seed;
+    if (hasher->blocks) seed ^= hasher->see1 ^ hasher->see2;
+    return str_hash_tail(pending, hasher->pending, seed, hasher->total);
+}
+
+//~ Builder
+// Text is appended into arena blocks that double in size, each one a node of the builder's
+// list. Nothing is copied to join blocks; flatten only when one contiguous string is needed.
+
+#define Str_BuilderFirstBlock Kilobytes(4)
+#define Str_BuilderMaxBlock Megabytes(1)
+
+static u8* str_builder_reserve(str_builder* builder, u64 size) {
+    if (builder->last && size <= builder->remaining) return builder->last->str.str + builder->last->str.size;
+    
+    u64 block_size = Max(builder->next_block_size, size);
+    string_const_list_node* node = arena_alloc(builder->arena, sizeof(string_const_list_node));
+    node->str.str = arena_alloc(builder->arena, block_size);
+    node->str.size = 0;
+    node->next = nullptr;
+    string_list_push_node(&builder->list, node);
+    builder->last = node;
+    builder->remaining = block_size;
+    builder->next_block_size = Min(builder->next_block_size * 2, Str_BuilderMaxBlock);
+    return node->str.str;
+}
+
+static void str_builder_commit(str_builder* builder, u64 size) {
+    builder->last->str.size += size;
+    builder->list.total_size += size;
+    builder->remaining -= size;
+}
+
+void str_builder_init(str_builder* builder, M_Arena* arena) {
+    MemoryZeroStruct(builder, *builder);
+    builder->arena = arena;
+    builder->next_block_size = Str_BuilderFirstBlock;
+}
+
+void str_builder_append(str_builder* builder, string_const str) {
+    if (str.size == 0) return;
+    u8* at = str_builder_reserve(builder, str.size);
+    memcpy(at, str.str, str.size);
+    str_builder_commit(builder, str.size);
+}
+
+void str_builder_appendf(str_builder* builder, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    
+    // Try the space left in the current block first; vsnprintf reports the real size if it doesn't fit
+    u8* at = builder->remaining ? builder->last->str.str + builder->last->str.size : nullptr;
+    va_list attempt;
+    va_copy(attempt, args);
+    int written = vsnprintf((char*) at, builder->remaining, format, attempt);
+    va_end(attempt);
+    assert(written >= 0 && "Invalid format string");
+    
+    if ((u64) written >= builder->remaining) {
+        if (written == 0) {
+            va_end(args);
+            return;
+        }
+        at = str_builder_reserve(builder, written + 1);
+        vsnprintf((char*) at, written + 1, format, args);
+    }
+    va_end(args);
+    str_builder_commit(builder, written);
+}
+
+string_const str_builder_flatten(M_Arena* arena, str_builder* builder) {
+    return string_list_flatten(arena, &builder->list);
+}
+
+//~ Interning
+// Tables are never freed while the pool lives: when one grows, readers still probing the old
+// table see a consistent (if slightly stale) snapshot instead of freed memory.
+
+#define Str_InternInitialCap 64
+
+static str_intern_table* str_intern_table_alloc(M_Arena* arena, u64 cap) {
+    str_intern_table* table = arena_alloc_zero(arena, sizeof(str_intern_table) + cap * sizeof(u64));
+    table->mask = cap - 1;
+    return table;
+}
+
+static void str_intern_table_insert(str_intern_table* table, u64 slot_value) {
+    u64 index = (slot_value >> 32) & table->mask;
+    while (atomic_load_explicit(&table->slots[index], memory_order_relaxed)) index = (index + 1) & table->mask;
+    atomic_store_explicit(&table->slots[index], slot_value, memory_order_release);
+}
+
+static str_atom str_intern_lookup(str_intern_pool* pool, string_const str, u64 hash) {
+    str_intern_table* table = atomic_load_explicit(&pool->table, memory_order_acquire);
+    u64 tag = hash >> 32;
+    for (u64 index = tag & table->mask;; index = (index + 1) & table->mask) {
+        u64 slot = atomic_load_explicit(&table->slots[index], memory_order_acquire);
+        if (!slot) return 0;
+        if ((slot >> 32) == tag) {
+            str_atom atom = (str_atom) slot;
+            if (str_eq(str_atom_string(pool, atom), str)) return atom;
+        }
+    }
+}
+
+void str_intern_init(str_intern_pool* pool) {
+    MemoryZeroStruct(pool, *pool);
+    arena_init(&pool->arena);
+    arena_set_tag(&pool->arena, "intern");
+    atomic_init(&pool->table, str_intern_table_alloc(&pool->arena, Str_InternInitialCap));
+    atomic_init(&pool->count, 0);
+    atomic_flag_clear(&pool->lock);
+}
+
+void str_intern_free(str_intern_pool* pool) {
+    arena_free(&pool->arena);
+    MemoryZeroStruct(pool, *pool);
+}
+
+str_atom str_intern(str_intern_pool* pool, string_const str) {
+    u64 hash = str_hash(str);
+    str_atom atom = str_intern_lookup(pool, str, hash);
+    if (atom) return atom;
+    
+    while (atomic_flag_test_and_set_explicit(&pool->lock, memory_order_acquire));
+    atom = str_intern_lookup(pool, str, hash);
+    if (!atom) {
+        atom = atomic_load_explicit(&pool->count, memory_order_relaxed) + 1;
+        assert(atom < Str_AtomPageSize * Str_AtomPageCount && "Intern pool is full");
+        
+        str_intern_table* table = atomic_load_explicit(&pool->table, memory_order_relaxed);
+        if ((u64) atom * 2 > table->mask + 1) {
+            str_intern_table* grown = str_intern_table_alloc(&pool->arena, (table->mask + 1) * 2);
+            for (u64 i = 0; i <= table->mask; i++) {
+                u64 slot = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+                if (slot) str_intern_table_insert(grown, slot);
             }
+            atomic_store_explicit(&pool->table, grown, memory_order_release);
+            table = grown;
         }
+        
+        string_const** page = &pool->pages[atom / Str_AtomPageSize];
+        if (!*page) *page = arena_alloc_array(&pool->arena, string_const, Str_AtomPageSize);
+        (*page)[atom % Str_AtomPageSize] = str_copy(&pool->arena, str);
+        atomic_store_explicit(&pool->count, atom, memory_order_relaxed);
+        str_intern_table_insert(table, ((hash >> 32) << 32) | atom);
     }
-    return i;
+    atomic_flag_clear_explicit(&pool->lock, memory_order_release);
+    return atom;
 }
 
-u64 str_find_last(string_const str, string_const needle, u32 offset) {
-    u64 prev = str.size;
-    if (offset == 0)
-        offset = str.size;
-    u64 idx = 0;
-    while (true) {
-        prev = idx;
-        idx = str_find_first(str, needle, idx);
-        if (idx >= offset) break;
-        idx++;
-    }
-    return prev;
-}
-
-u32 str_hash(string_const str) {
-    u32 hash = 2166136261u;
-    for (int i = 0; i < str.size; i++) {
-        hash ^= str.str[i];
-        hash *= 16777619;
-    }
-    return hash;
+str_atom str_intern_find(str_intern_pool* pool, string_const str) {
+    return str_intern_lookup(pool, str, str_hash(str));
+}
+
+string_const str_atom_string(str_intern_pool* pool, str_atom atom) {
+    if (atom == 0) return (string_const) {0};
+    return pool->pages[atom / Str_AtomPageSize][atom % Str_AtomPageSize];
 }
 
 void string_list_push_node(string_const_list* list, string_const_list_node* node) {
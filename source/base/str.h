@@ -4,6 +4,7 @@
 #define STR_H
 
 #include <string.h>
+#include <stdarg.h>
 #include "mem.h"
 
 typedef struct string_const {
@@ -40,26 +41,97 @@ void string_array_free(string_const_array* array);
 //-
 
 #define str_lit(s) (string_const) { .str = (u8*)(s), .size = sizeof(s) - 1 }
+#define str_cstring(s) (string_const) { .str = (u8*)(s), .size = strlen(s) }
 #define str_expand(s) (i32)(s).size, (s).str
 
 string_const str_alloc(M_Arena* arena, u64 size); // NOTE(EVERYONE): this will try to get one extra byte for \0
 string_const str_copy(M_Arena* arena, string_const other);
 string_const str_cat(M_Arena* arena, string_const a, string_const b);
 string_const str_from_format(M_Arena* arena, const char* format, ...);
+string_const str_from_formatv(M_Arena* arena, const char* format, va_list args);
 string_const str_replace_all(M_Arena* arena, string_const to_fix, string_const needle, string_const replacement);
+// Replaces all patterns in one pass. At each position patterns are tried in order and the first
+// match wins, so put longer patterns before their prefixes. Up to 64 patterns.
+string_const str_replace_many(M_Arena* arena, string_const to_fix, string_const* needles, string_const* replacements, u32 count);
 u64 str_substr_count(string_const str, string_const needle);
-u64 str_find_first(string_const str, string_const needle, u32 offset);
+u64 str_find_first(string_const str, string_const needle, u32 offset); // str.size when not found
+// One past the start of the last match that starts before offset (0 means the whole string), 0 when not found
 u64 str_find_last(string_const str, string_const needle, u32 offset);
-u32 str_hash(string_const str);
+u64 str_hash(string_const str);
+u64 str_hash_seeded(string_const str, u64 seed);
 
 b8 str_eq(string_const a, string_const b);
 
+// Incremental str_hash for data that arrives in pieces, e.g. a file read in chunks.
+// Produces the same value as str_hash_seeded over the concatenated input.
+typedef struct str_hasher {
+    u64 seed;
+    u64 see1;
+    u64 see2;
+    u64 total;
+    u64 pending;
+    b8 blocks;
+    u8 buffer[64];
+} str_hasher;
+
+void str_hasher_init(str_hasher* hasher, u64 seed);
+void str_hasher_update(str_hasher* hasher, string_const data);
+u64  str_hasher_final(str_hasher* hasher);
+
 void string_list_push_node(string_const_list* list, string_const_list_node* node);
 void string_list_push(M_Arena* arena, string_const_list* list, string_const str);
 b8   string_list_equals(string_const_list* a, string_const_list* b);
 b8   string_list_contains(string_const_list* a, string_const needle);
 string_const string_list_flatten(M_Arena* arena, string_const_list* list);
 
+//- Builder
+// Accumulates appended and formatted text in growing arena blocks. The blocks are kept as a
+// string_list (walk builder.list to write them out) and only joined by str_builder_flatten.
+
+typedef struct str_builder {
+    M_Arena* arena;
+    string_const_list list;
+    string_const_list_node* last;
+    u64 remaining; // Free bytes after the last block's text
+    u64 next_block_size;
+} str_builder;
+
+void str_builder_init(str_builder* builder, M_Arena* arena);
+void str_builder_append(str_builder* builder, string_const str);
+void str_builder_appendf(str_builder* builder, const char* format, ...);
+string_const str_builder_flatten(M_Arena* arena, str_builder* builder);
+
+//- Interning
+// Maps each distinct string to a small integer atom, so names that are compared or hashed often
+// can be compared as integers. Strings are copied into the pool's arena and never move.
+// Lookups are lock-free; interning a new string takes a spinlock, which is fine for the rare
+// first sight of a name but not meant for hot insert loops.
+
+typedef u32 str_atom; // 0 is never a valid atom
+
+#define Str_AtomPageSize 1024
+#define Str_AtomPageCount 256
+
+typedef struct str_intern_table {
+    u64 mask;
+    _Atomic(u64) slots[]; // (hash >> 32) << 32 | atom, 0 while empty
+} str_intern_table;
+
+typedef struct str_intern_pool {
+    M_Arena arena;
+    _Atomic(str_intern_table*) table;
+    string_const* pages[Str_AtomPageCount];
+    _Atomic(u32) count;
+    atomic_flag lock;
+} str_intern_pool;
+
+void str_intern_init(str_intern_pool* pool);
+void str_intern_free(str_intern_pool* pool);
+str_atom str_intern(str_intern_pool* pool, string_const str);
+// Lock-free. Returns 0 when str was never interned (or is being interned right now on another thread).
+str_atom str_intern_find(str_intern_pool* pool, string_const str);
+string_const str_atom_string(str_intern_pool* pool, str_atom atom);
+
 //- Encoding Stuff 
 
 typedef struct string_utf16_const {
@@ -45,11 +45,14 @@ U_DateTime U_DateTimeFromDenseTime(U_DenseTime densetime) {
 //~ Time
 
 string U_FixFilepath(M_Arena* arena, string filepath) {
-    M_Scratch scratch = scratch_get();
+    M_Scratch scratch = scratch_get(&arena, 1);
     
-    string fixed = filepath;
-    fixed = str_replace_all(&scratch.arena, fixed, str_lit("\\"), str_lit("/"));
-    fixed = str_replace_all(arena, fixed, str_lit("/./"), str_lit("/"));
+    // Backslashes map one byte to one byte, so they are swapped in place on a single copy
+    string fixed = str_copy(scratch.arena, filepath);
+    for (u64 i = 0; i < fixed.size; i++) {
+        if (fixed.str[i] == '\\') fixed.str[i] = '/';
+    }
+    fixed = str_replace_all(scratch.arena, fixed, str_lit("/./"), str_lit("/"));
     while (true) {
         u64 dotdot = str_find_first(fixed, str_lit(".."), 0);
         if (dotdot == fixed.size) break;
@@ -58,25 +61,26 @@ string U_FixFilepath(M_Arena* arena, string filepath) {
         
         u64 range = (dotdot + 3) - last_slash;
         string old = fixed;
-        fixed = str_alloc(&scratch.arena, fixed.size - range);
+        fixed = str_alloc(scratch.arena, fixed.size - range);
         memcpy(fixed.str, old.str, last_slash);
         memcpy(fixed.str + last_slash, old.str + dotdot + 3, old.size - range - last_slash + 1);
     }
     
+    fixed = str_copy(arena, fixed);
     scratch_return(&scratch);
     
     return fixed;
 }
 
 string U_GetFullFilepath(M_Arena* arena, string filename) {
-    M_Scratch scratch = scratch_get();
+    M_Scratch scratch = scratch_get(&arena, 1);
     
     char buffer[PATH_MAX];
     get_cwd(buffer, PATH_MAX);
     string cwd = { .str = (u8*) buffer, .size = strlen(buffer) };
     
-    string finalized = str_cat(&scratch.arena, cwd, str_lit("/"));
-    finalized = str_cat(&scratch.arena, finalized, filename);
+    string finalized = str_cat(scratch.arena, cwd, str_lit("/"));
+    finalized = str_cat(scratch.arena, finalized, filename);
     finalized = U_FixFilepath(arena, finalized);
     
     scratch_return(&scratch);
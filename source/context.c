@@ -2,12 +2,18 @@
 
 #include <GLFW/glfw3.h>
 
-Array_Impl(StringArray, const char*);
+SmallArray_Impl(StringArray, const char*, 8);
 Array_Impl(VkImageArray, VkImage);
 
 static b8 u32_eq(u32 a, u32 b) { return a == b; }
-Set_Impl(U32Set, u32, u32_eq);
-Array_Impl(VkDeviceQueueCreateInfoArray, VkDeviceQueueCreateInfo);
+static u32 u32_hash(u32 a) {
+    a ^= a >> 16; a *= 0x7feb352d;
+    a ^= a >> 15; a *= 0x846ca68b;
+    a ^= a >> 16;
+    return a;
+}
+Set_ImplHashed(U32Set, u32, u32_eq, u32_hash);
+SmallArray_Impl(VkDeviceQueueCreateInfoArray, VkDeviceQueueCreateInfo, 4);
 
 #include "vulkan_ext.h"
 
@@ -24,43 +30,69 @@ debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 
 //~ Helpers
 
-static StringArray V_GetGLFWRequiredExtensions() {
-    StringArray sa = {0};
+static void V_GetGLFWRequiredExtensions(StringArray* sa) {
     u32 intermediate_len;
     const char** intermediate = glfwGetRequiredInstanceExtensions(&intermediate_len);
-    for (u32 i = 0; i < intermediate_len; i++) {
-        StringArray_add(&sa, intermediate[i]);
+    StringArray_add_many(sa, intermediate, intermediate_len);
+}
+
+static void V_GetDeviceRequiredExtensions(StringArray* sa) {
+    StringArray_add(sa, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+}
+
+// Checks that every required name is among count structs of stride bytes holding a name at offset.
+// Up to V_RequiredMax required names, their atoms go in a small table mapping each one to its
+// required bits, so every available name costs one intern probe and one table probe. Longer lists
+// (never seen in practice) fall back to comparing every pair.
+#define V_RequiredMax 64
+#define V_RequiredSlots 128
+
+static b8 V_NamesSupportedSlow(StringArray* required, void* available, u64 offset, u32 count, u64 stride) {
+    IteratePtr(required, k) {
+        b8 found = false;
+        for (u32 i = 0; i < count; i++) {
+            if (strcmp(required->elems[k], (char*) available + i * stride + offset) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
     }
-    return sa;
+    return true;
 }
 
-static StringArray V_GetDeviceRequiredExtensions() {
-    StringArray sa = {0};
-    StringArray_add(&sa, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
-    return sa;
+static b8 V_NamesSupported(V_VulkanContext* context, StringArray* required, void* available, u64 offset, u32 count, u64 stride) {
+    if (required->len > V_RequiredMax) return V_NamesSupportedSlow(required, available, offset, count, stride);
+    str_atom slot_atoms[V_RequiredSlots] = {0};
+    u64 slot_bits[V_RequiredSlots] = {0};
+    IteratePtr(required, k) {
+        str_atom atom = str_intern(&context->names, str_cstring(required->elems[k]));
+        u32 slot = (atom * 2654435761u) % V_RequiredSlots;
+        while (slot_atoms[slot] && slot_atoms[slot] != atom) slot = (slot + 1) % V_RequiredSlots;
+        slot_atoms[slot] = atom;
+        slot_bits[slot] |= 1ull << k;
+    }
+    
+    u64 found = 0;
+    for (u32 i = 0; i < count; i++) {
+        str_atom atom = str_intern_find(&context->names, str_cstring((char*) available + i * stride + offset));
+        if (!atom) continue;
+        u32 slot = (atom * 2654435761u) % V_RequiredSlots;
+        while (slot_atoms[slot] && slot_atoms[slot] != atom) slot = (slot + 1) % V_RequiredSlots;
+        found |= slot_bits[slot];
+    }
+    return found == (required->len == V_RequiredMax ? u64_max : (1ull << required->len) - 1);
 }
 
-static b8 V_ValidationLayersSupported(StringArray sa) {
+static b8 V_ValidationLayersSupported(V_VulkanContext* context, StringArray* sa) {
     u32 layer_count;
     vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
     VkLayerProperties* props = calloc(layer_count, sizeof(VkLayerProperties));
     vkEnumerateInstanceLayerProperties(&layer_count, props);
     
-    Iterate(sa, k) {
-        b8 layer_is_available = false;
-        for (u32 i = 0; i < layer_count; i++) {
-            if (strcmp(sa.elems[k], props[i].layerName) == 0) {
-                layer_is_available = true;
-            }
-        }
-        
-        if (!layer_is_available) {
-            free(props);
-            return false;
-        }
-    }
+    b8 supported = V_NamesSupported(context, sa, props, offsetof(VkLayerProperties, layerName), layer_count, sizeof(VkLayerProperties));
     free(props);
-    return true;
+    return supported;
 }
 
 static void V_FillDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT* dest) {
@@ -106,28 +138,15 @@ V_QueueFamilyIndices V_FindQueueFamilies(V_VulkanContext* context, VkPhysicalDev
     return indices;
 }
 
-static b8 V_DeviceExtensionsSupported(VkPhysicalDevice device, StringArray sa) {
+static b8 V_DeviceExtensionsSupported(V_VulkanContext* context, VkPhysicalDevice device, StringArray* sa) {
     u32 extension_count = 0;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
     VkExtensionProperties* supported_extensions = calloc(extension_count, sizeof(VkExtensionProperties));
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, supported_extensions);
     
-    Iterate(sa, k) {
-        b8 found = false;
-        
-        for (u32 i = 0; i < extension_count; i++) {
-            if (strcmp(sa.elems[k], supported_extensions[i].extensionName) == 0) {
-                found = true;
-            }
-        }
-        if (!found) {
-            free(supported_extensions);
-            return false;
-        }
-    }
-    
+    b8 supported = V_NamesSupported(context, sa, supported_extensions, offsetof(VkExtensionProperties, extensionName), extension_count, sizeof(VkExtensionProperties));
     free(supported_extensions);
-    return true;
+    return supported;
 }
 
 typedef struct V_SwapchainDetails {
@@ -170,8 +189,11 @@ static u32 V_ScoreDevice(V_VulkanContext* context, VkPhysicalDevice device) {
     V_QueueFamilyIndices queue_families = V_FindQueueFamilies(context, device);
     if (!V_QueueFamilyIndicesValid(queue_families)) return 0;
     
-    StringArray required_device_extensions = V_GetDeviceRequiredExtensions();
-    if (!V_DeviceExtensionsSupported(device, required_device_extensions)) return 0;
+    StringArray required_device_extensions = {0};
+    V_GetDeviceRequiredExtensions(&required_device_extensions);
+    b8 extensions_supported = V_DeviceExtensionsSupported(context, device, &required_device_extensions);
+    StringArray_free(&required_device_extensions);
+    if (!extensions_supported) return 0;
     
     V_SwapchainDetails swapchain_details = V_SwapchainSupportDetails(context, device);
     if (!V_SwapchainIsAdequate(swapchain_details)) return 0;
@@ -191,7 +213,6 @@ static u32 V_ScoreDevice(V_VulkanContext* context, VkPhysicalDevice device) {
     }
     
     V_FreeSwapchainDetails(swapchain_details);
-    StringArray_free(&required_device_extensions);
     return score;
 }
 
@@ -239,11 +260,11 @@ static b8 V_CreateInstance(V_VulkanContext* context, b8 debug_mode) {
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.apiVersion = VK_VERSION_1_3;
     
-    context->extensions = V_GetGLFWRequiredExtensions();
+    V_GetGLFWRequiredExtensions(&context->extensions);
     if (debug_mode) {
         StringArray_add(&context->extensions, VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         StringArray_add(&context->layers, "VK_LAYER_KHRONOS_validation");
-        V_ValidationLayersSupported(context->layers);
+        V_ValidationLayersSupported(context, &context->layers);
     }
     
     VkInstanceCreateInfo instance_create_info = {0};
@@ -312,7 +333,7 @@ static b8 V_CreateLogicalDevice(V_VulkanContext* context, b8 debug_mode) {
     U32Set_add(&unique_queue_set, indices.present_family.value);
     
     f32 queue_priority = 1.f;
-    VkDeviceQueueCreateInfoArray queue_create_infos;
+    VkDeviceQueueCreateInfoArray queue_create_infos = {0};
     for (u32 i = 0; i < unique_queue_set.len; i++) {
         VkDeviceQueueCreateInfo queue_create_info = {0};
         queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -322,7 +343,8 @@ static b8 V_CreateLogicalDevice(V_VulkanContext* context, b8 debug_mode) {
         VkDeviceQueueCreateInfoArray_add(&queue_create_infos, queue_create_info);
     }
     
-    StringArray required_device_extensions = V_GetDeviceRequiredExtensions();
+    StringArray required_device_extensions = {0};
+    V_GetDeviceRequiredExtensions(&required_device_extensions);
     
     VkPhysicalDeviceFeatures physical_device_features = {0};
     VkDeviceCreateInfo device_create_info = {0};
@@ -340,6 +362,7 @@ static b8 V_CreateLogicalDevice(V_VulkanContext* context, b8 debug_mode) {
     vkGetDeviceQueue(context->device, indices.present_family.value, 0, &context->present_queue);
     
     StringArray_free(&required_device_extensions);
+    VkDeviceQueueCreateInfoArray_free(&queue_create_infos);
     
     return true;
 }
@@ -428,6 +451,7 @@ static b8 V_CreateSwapchain(W_Window* window, V_VulkanContext* context, b8 debug
 }
 
 void Vulkan_Init(W_Window* window, V_VulkanContext* context, b8 debug_mode) {
+    str_intern_init(&context->names);
     Assert(V_CreateInstance(context, debug_mode), "Instance Creation Failed\n");
     Assert(V_CreateDebugMessenger(context, debug_mode), "Debug Messenger Creation Failed\n");
     Assert(V_CreateSurface(window, context, debug_mode), "Debug Messenger Creation Failed\n");
@@ -450,4 +474,5 @@ void Vulkan_Free(V_VulkanContext* context, b8 debug_mode) {
     vkDestroyInstance(context->instance, nullptr);
     StringArray_free(&context->extensions);
     StringArray_free(&context->layers);
+    str_intern_free(&context->names);
 }
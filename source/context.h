@@ -10,15 +10,16 @@
 #include "base/utils.h"
 #include "window.h"
 
-Array_Prototype(StringArray, const char*);
+SmallArray_Prototype(StringArray, const char*, 8);
 Array_Prototype(VkImageArray, VkImage);
 Set_Prototype(U32Set, u32);
-Array_Prototype(VkDeviceQueueCreateInfoArray, VkDeviceQueueCreateInfo);
+SmallArray_Prototype(VkDeviceQueueCreateInfoArray, VkDeviceQueueCreateInfo, 4);
 
 typedef struct V_VulkanContext {
     VkInstance instance;
     StringArray extensions;
     StringArray layers;
+    str_intern_pool names; // Extension and layer names, compared by atom
     
     VkPhysicalDevice physical_device;
     VkDevice device;
@@ -39,6 +39,7 @@ typedef void void_func(void);
 
 #define null 0
 #define u32_max 4294967295
+#define u64_max 18446744073709551615ull
 
 #ifndef __cplusplus
 #define nullptr (void*)0
@@ -52,6 +53,12 @@ typedef void void_func(void);
 #  define COMPILER_GCC
 #endif
 
+#if defined(COMPILER_CL)
+#  define thread_var __declspec(thread)
+#else
+#  define thread_var _Thread_local
+#endif
+
 #if defined(COMPILER_CLANG)
 #  define FILE_NAME __FILE_NAME__
 #else
@@ -102,9 +109,11 @@ flush;\
 #  define dll_plugin_api dll_export
 #endif
 
-#define Gigabytes(count) (u64) (count * 1024 * 1024 * 1024)
-#define Megabytes(count) (u64) (count * 1024 * 1024)
-#define Kilobytes(count) (u64) (count * 1024)
+#define CACHE_LINE_SIZE 64
+
+#define Gigabytes(count) ((u64) (count) * 1024 * 1024 * 1024)
+#define Megabytes(count) ((u64) (count) * 1024 * 1024)
+#define Kilobytes(count) ((u64) (count) * 1024)
 
 #define Min(a,b) (((a)<(b))?(a):(b))
 #define Max(a,b) (((a)>(b))?(a):(b))
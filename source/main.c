@@ -11,6 +11,10 @@ VkSemaphore image_available_semaphore;
 VkSemaphore render_finished_semaphore;
 VkFence in_flight_fence;
 
+#define FRAMES_IN_FLIGHT 1
+M_FrameArenas frame_arenas;
+u64 frame_index;
+
 static void CreateSyncObjects(V_VulkanContext* context, V_VulkanPipeline* pipeline) {
     VkSemaphoreCreateInfo semaphore_create_info = {0};
     semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -41,6 +45,8 @@ static void FreeSyncObjects(V_VulkanContext* context, V_VulkanPipeline* pipeline
 static void Draw(V_VulkanContext* context, V_VulkanPipeline* pipeline) {
     vkWaitForFences(context->device, 1, &in_flight_fence, VK_TRUE, U32_MAX);
     vkResetFences(context->device, 1, &in_flight_fence);
+    // The GPU is done with this frame's slot, so its transient data can go
+    frame_arenas_begin(&frame_arenas, frame_index++);
     
     u32 image_index;
     vkAcquireNextImageKHR(context->device, context->swapchain, U32_MAX, image_available_semaphore, VK_NULL_HANDLE, &image_index);
@@ -80,6 +86,7 @@ static void Draw(V_VulkanContext* context, V_VulkanPipeline* pipeline) {
 
 int main() {
     M_ScratchInit();
+    frame_arenas_init(&frame_arenas, FRAMES_IN_FLIGHT);
     
     W_Window window = {0};
     V_VulkanContext context = {0};
@@ -101,11 +108,13 @@ int main() {
     }
     vkDeviceWaitIdle(context.device);
     
+    M_ArenaReportAll(stdout);
     FreeSyncObjects(&context, &pipeline);
     Vulkan_PipelineFree(&context, &pipeline);
     Vulkan_Free(&context, DEBUG);
     
     Window_Free(&window);
     
+    frame_arenas_free(&frame_arenas);
     M_ScratchFree();
 }
@@ -72,10 +72,10 @@ static b8 V_CreateRenderpass(V_VulkanContext* context, V_VulkanPipeline* pipelin
 }
 
 static b8 V_CreatePipelineLayout(V_VulkanContext* context, V_VulkanPipeline* pipeline) {
-    M_Scratch scratch = scratch_get();
+    M_Scratch scratch = scratch_get(nullptr, 0);
     u64 vert_code_size, frag_code_size;
-    u8* vert_code = V_LoadFile(&scratch.arena, str_lit("res/basic.vert.spv"), &vert_code_size);
-    u8* frag_code = V_LoadFile(&scratch.arena, str_lit("res/basic.frag.spv"), &frag_code_size);
+    u8* vert_code = V_LoadFile(scratch.arena, str_lit("res/basic.vert.spv"), &vert_code_size);
+    u8* frag_code = V_LoadFile(scratch.arena, str_lit("res/basic.frag.spv"), &frag_code_size);
     
     VkShaderModule vertex_shader = V_CreateShaderModule(context, vert_code, vert_code_size);
     VkShaderModule fragment_shader = V_CreateShaderModule(context, frag_code, frag_code_size);
@@ -270,6 +270,7 @@ static b8 V_CreateCommandPoolAndBuffer(V_VulkanContext* context, V_VulkanPipelin
 
 void Vulkan_PipelineInit(V_VulkanContext* context, V_VulkanPipeline* pipeline) {
     arena_init(&pipeline->arena);
+    arena_set_tag(&pipeline->arena, "pipeline");
     
     Assert(V_CreateRenderpass(context, pipeline), "Renderpass Creation Failed\n");
     Assert(V_CreatePipelineLayout(context, pipeline), "Pipeline Layout Creation Failed\n");
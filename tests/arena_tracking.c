@@ -0,0 +1,58 @@
+#include "test_common.h"
+#include "base/mem.h"
+#include "base/str.h"
+#include <string.h>
+
+// The tracking macros must behave like the plain functions: arguments evaluated once, and each
+// allocation charged to its caller with the bytes it actually keeps.
+
+static M_Arena arenas[2];
+static u32 next_calls;
+
+static M_Arena* next_arena(void) {
+    return &arenas[next_calls++ % 2];
+}
+
+#if M_ARENA_TRACKING
+static u64 site_bytes(M_Arena* arena, const char* file) {
+    u64 bytes = 0;
+    for (u32 i = 0; i < M_ARENA_TRACKED_SITES; i++) {
+        M_ArenaSite* site = &arena->tracking.sites[i];
+        if (site->file && strstr(site->file, file)) bytes += site->bytes;
+    }
+    return bytes;
+}
+#endif
+
+int main() {
+    arena_init(&arenas[0]);
+    arena_init(&arenas[1]);
+    
+    arena_alloc(next_arena(), 64);
+    arena_alloc_zero(next_arena(), 64);
+    arena_alloc_aligned(next_arena(), 64, 64);
+    arena_alloc_array(next_arena(), u32, 16);
+    Check(next_calls == 4, "arena argument evaluated %u times for 4 allocations", next_calls);
+    Check(arena_get_pos(&arenas[0]) >= 128 && arena_get_pos(&arenas[1]) >= 128, "allocations went to the wrong arena");
+    
+    M_Arena arena;
+    arena_init(&arena);
+    string_const short_str = str_from_format(&arena, "%s_%d", "Vertex", 7);
+    Check(str_eq(short_str, str_lit("Vertex_7")), "short format gave %.*s", str_expand(short_str));
+    char big[1000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    string_const long_str = str_from_format(&arena, "[%s]", big);
+    Check(long_str.size == 1001 && long_str.str[0] == '[' && long_str.str[1000] == ']', "long format truncated to %llu", long_str.size);
+#if M_ARENA_TRACKING
+    // str_alloc keeps a terminator, so each string holds size + 1 bytes
+    u64 recorded = site_bytes(&arena, "str.c");
+    Check(recorded == short_str.size + 1 + long_str.size + 1, "str_from_format recorded %llu bytes, kept %llu", recorded, short_str.size + long_str.size + 2);
+#endif
+    
+    arena_free(&arena);
+    arena_free(&arenas[0]);
+    arena_free(&arenas[1]);
+    printf("arena_tracking: single evaluation and format sizes ok\n");
+    return 0;
+}
@@ -0,0 +1,18 @@
+@ECHO off
+REM build script for the standalone tests in tests\, run from the repo root
+SetLocal EnableDelayedExpansion
+
+SET base=source/base/mem.c source/base/str.c source/base/bitset.c
+SET compiler_flags=-O2 -Wvarargs -Wall -Werror
+SET wexcludes=-Wno-unused-function
+SET include_flags=-Isource -Itests
+SET defines=-D_CRT_SECURE_NO_WARNINGS -DDEBUG=1
+
+IF NOT EXIST bin\tests MKDIR bin\tests
+
+FOR %%f in (tests\*.c) do (
+	ECHO     Building %%~nf...
+	clang %%f %base% %compiler_flags% %wexcludes% -o ./bin/tests/%%~nf.exe %defines% %include_flags%
+	REM Tracking changes what the arenas do on every allocation, so the tests run against both builds
+	clang %%f %base% %compiler_flags% %wexcludes% -o ./bin/tests/%%~nf_tracked.exe %defines% -DM_ARENA_TRACKING=1 %include_flags%
+)
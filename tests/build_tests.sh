@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds and runs the standalone tests in tests/, run from the repo root. Mirrors build_tests.bat
+set -e
+base="source/base/mem.c source/base/str.c source/base/bitset.c"
+flags="-O2 -Wall -Werror -Wno-unused-function -DDEBUG=1 -Isource -Itests"
+mkdir -p bin/tests
+
+for f in tests/*.c; do
+    name=$(basename "$f" .c)
+    ${CC:-cc} "$f" $base $flags -o "bin/tests/$name" -lpthread -lm
+    ${CC:-cc} "$f" $base $flags -DM_ARENA_TRACKING=1 -o "bin/tests/${name}_tracked" -lpthread -lm
+    "bin/tests/$name"
+    "bin/tests/${name}_tracked"
+done
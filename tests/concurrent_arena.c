@@ -0,0 +1,50 @@
+#include "test_common.h"
+#include "base/mem.h"
+#include <string.h>
+
+// Checks that threads allocating from one concurrent arena never get overlapping memory, and
+// measures throughput from 1 to ThreadMax threads, on the first frame (which commits) and on
+// later frames (which reuse what is committed). Scaling needs as many cores as threads.
+
+#define ThreadMax 8
+#define AllocsPerThread 2000000
+
+static M_ConcurrentArena arena;
+
+static T_ThreadFunc(alloc_worker) {
+    u64 id = (u64) arg;
+    for (u64 i = 0; i < AllocsPerThread; i++) {
+        u64* small = concurrent_arena_alloc(&arena, i % 7 == 0 ? 48 : 16);
+        small[0] = id;
+        small[1] = i;
+        if (i % 100000 == 0) {
+            u8* big = concurrent_arena_alloc_aligned(&arena, 100000, 64);
+            Check(((u64) big & 63) == 0, "big allocation is not 64-byte aligned");
+            memset(big, (int) id, 100000);
+        }
+        Check(small[0] == id && small[1] == i, "thread %llu's allocation was overwritten", id);
+    }
+    return 0;
+}
+
+static f64 run_frame(u32 thread_count) {
+    T_Thread threads[ThreadMax];
+    f64 start = T_Now();
+    for (u64 i = 0; i < thread_count; i++) threads[i] = T_ThreadStart(alloc_worker, (void*) i);
+    for (u32 i = 0; i < thread_count; i++) T_ThreadJoin(threads[i]);
+    f64 seconds = T_Now() - start;
+    concurrent_arena_reset(&arena);
+    return thread_count * (f64) AllocsPerThread / seconds / 1e6;
+}
+
+int main() {
+    for (u32 thread_count = 1; thread_count <= ThreadMax; thread_count *= 2) {
+        concurrent_arena_init(&arena, Gigabytes(4));
+        f64 first = run_frame(thread_count);
+        f64 steady = run_frame(thread_count);
+        printf("concurrent_arena: %u threads, first frame %.1f M allocs/s, later frames %.1f M allocs/s\n",
+               thread_count, first, steady);
+        concurrent_arena_free(&arena);
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "test_common.h"
+#include "base/ds.h"
+
+// Throughput and latency of the concurrent queues. Throughput pushes a known sequence through
+// and checks every value arrives (in order for SPSC). Latency bounces one value between two
+// threads over a pair of queues and reports the one-way time (half a round trip). Waiting sides
+// spin briefly and then yield, so the numbers only mean something with a core per thread.
+
+SPSCQueue_Prototype(U64SPSCQueue, u64)
+SPSCQueue_Impl(U64SPSCQueue, u64)
+MPMCQueue_Prototype(U64MPMCQueue, u64)
+MPMCQueue_Impl(U64MPMCQueue, u64)
+
+#define F64Less(a, b) ((a) < (b))
+Sort_Prototype(F64Sort, f64)
+Sort_Impl(F64Sort, f64, F64Less)
+
+#define ThroughputCount 2000000ull
+#define LatencyRounds 20000
+#define QueueCapacity 1024
+#define ThreadMax 8
+
+static inline void backoff(u32* spins) {
+    if (++*spins > 64) {
+        T_Yield();
+        *spins = 0;
+    }
+}
+
+//~ Throughput
+
+static U64SPSCQueue spsc;
+static U64MPMCQueue mpmc;
+static u32 producer_count;
+static _Atomic(u64) consumed;
+static _Atomic(u64) consumed_sum;
+
+static T_ThreadFunc(spsc_producer) {
+    u32 spins = 0;
+    for (u64 i = 1; i <= ThroughputCount; i++) {
+        while (!U64SPSCQueue_push(&spsc, i)) backoff(&spins);
+    }
+    return 0;
+}
+
+static T_ThreadFunc(mpmc_producer) {
+    u32 spins = 0;
+    for (u64 i = 1; i <= ThroughputCount / producer_count; i++) {
+        while (!U64MPMCQueue_push(&mpmc, i)) backoff(&spins);
+    }
+    return 0;
+}
+
+static T_ThreadFunc(mpmc_consumer) {
+    u64 total = ThroughputCount / producer_count * producer_count;
+    u64 value, sum = 0;
+    u32 spins = 0;
+    while (atomic_load_explicit(&consumed, memory_order_relaxed) < total) {
+        if (U64MPMCQueue_pop(&mpmc, &value)) {
+            sum += value;
+            atomic_fetch_add_explicit(&consumed, 1, memory_order_relaxed);
+        } else backoff(&spins);
+    }
+    atomic_fetch_add(&consumed_sum, sum);
+    return 0;
+}
+
+static void spsc_throughput(void) {
+    U64SPSCQueue_init(&spsc, QueueCapacity, nullptr);
+    f64 start = T_Now();
+    T_Thread producer = T_ThreadStart(spsc_producer, nullptr);
+    u64 value;
+    u32 spins = 0;
+    for (u64 i = 1; i <= ThroughputCount; i++) {
+        while (!U64SPSCQueue_pop(&spsc, &value)) backoff(&spins);
+        Check(value == i, "SPSC popped %llu, expected %llu", value, i);
+    }
+    T_ThreadJoin(producer);
+    printf("queue_bench: spsc 1p1c throughput %.1f M ops/s\n", ThroughputCount / (T_Now() - start) / 1e6);
+    U64SPSCQueue_free(&spsc);
+}
+
+static void mpmc_throughput(u32 threads) {
+    U64MPMCQueue_init(&mpmc, QueueCapacity, nullptr);
+    producer_count = threads;
+    atomic_store(&consumed, 0);
+    atomic_store(&consumed_sum, 0);
+    
+    T_Thread workers[ThreadMax * 2];
+    f64 start = T_Now();
+    for (u32 i = 0; i < threads; i++) workers[i] = T_ThreadStart(mpmc_producer, nullptr);
+    for (u32 i = 0; i < threads; i++) workers[threads + i] = T_ThreadStart(mpmc_consumer, nullptr);
+    for (u32 i = 0; i < threads * 2; i++) T_ThreadJoin(workers[i]);
+    f64 seconds = T_Now() - start;
+    
+    u64 per_producer = ThroughputCount / threads;
+    u64 expected = threads * (per_producer * (per_producer + 1) / 2);
+    Check(atomic_load(&consumed_sum) == expected, "MPMC %up%uc lost or duplicated values", threads, threads);
+    printf("queue_bench: mpmc %up%uc throughput %.1f M ops/s\n", threads, threads, per_producer * threads / seconds / 1e6);
+    U64MPMCQueue_free(&mpmc);
+}
+
+//~ Latency
+
+static U64SPSCQueue spsc_ping, spsc_pong;
+static U64MPMCQueue mpmc_ping, mpmc_pong;
+
+static T_ThreadFunc(spsc_echo) {
+    u64 value;
+    u32 spins = 0;
+    for (u32 i = 0; i < LatencyRounds; i++) {
+        while (!U64SPSCQueue_pop(&spsc_ping, &value)) backoff(&spins);
+        while (!U64SPSCQueue_push(&spsc_pong, value)) backoff(&spins);
+    }
+    return 0;
+}
+
+static T_ThreadFunc(mpmc_echo) {
+    u64 value;
+    u32 spins = 0;
+    for (u32 i = 0; i < LatencyRounds; i++) {
+        while (!U64MPMCQueue_pop(&mpmc_ping, &value)) backoff(&spins);
+        while (!U64MPMCQueue_push(&mpmc_pong, value)) backoff(&spins);
+    }
+    return 0;
+}
+
+static void report_latency(const char* name, f64* samples) {
+    F64Sort(samples, LatencyRounds);
+    printf("queue_bench: %s one-way latency median %.0f ns, p99 %.0f ns, max %.0f ns\n", name,
+           samples[LatencyRounds / 2] * 0.5e9, samples[LatencyRounds * 99 / 100] * 0.5e9, samples[LatencyRounds - 1] * 0.5e9);
+}
+
+static void latency(f64* samples) {
+    u64 value;
+    u32 spins = 0;
+    
+    U64SPSCQueue_init(&spsc_ping, 16, nullptr);
+    U64SPSCQueue_init(&spsc_pong, 16, nullptr);
+    T_Thread echo = T_ThreadStart(spsc_echo, nullptr);
+    for (u32 i = 0; i < LatencyRounds; i++) {
+        f64 start = T_Now();
+        while (!U64SPSCQueue_push(&spsc_ping, i)) backoff(&spins);
+        while (!U64SPSCQueue_pop(&spsc_pong, &value)) backoff(&spins);
+        samples[i] = T_Now() - start;
+        Check(value == i, "SPSC echoed %llu, expected %u", value, i);
+    }
+    T_ThreadJoin(echo);
+    report_latency("spsc", samples);
+    U64SPSCQueue_free(&spsc_ping);
+    U64SPSCQueue_free(&spsc_pong);
+    
+    U64MPMCQueue_init(&mpmc_ping, 16, nullptr);
+    U64MPMCQueue_init(&mpmc_pong, 16, nullptr);
+    echo = T_ThreadStart(mpmc_echo, nullptr);
+    for (u32 i = 0; i < LatencyRounds; i++) {
+        f64 start = T_Now();
+        while (!U64MPMCQueue_push(&mpmc_ping, i)) backoff(&spins);
+        while (!U64MPMCQueue_pop(&mpmc_pong, &value)) backoff(&spins);
+        samples[i] = T_Now() - start;
+        Check(value == i, "MPMC echoed %llu, expected %u", value, i);
+    }
+    T_ThreadJoin(echo);
+    report_latency("mpmc", samples);
+    U64MPMCQueue_free(&mpmc_ping);
+    U64MPMCQueue_free(&mpmc_pong);
+}
+
+int main() {
+    spsc_throughput();
+    for (u32 threads = 1; threads <= ThreadMax; threads *= 2) mpmc_throughput(threads);
+    
+    f64* samples = malloc(LatencyRounds * sizeof(f64));
+    latency(samples);
+    free(samples);
+    return 0;
+}
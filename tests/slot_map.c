@@ -0,0 +1,49 @@
+#include "test_common.h"
+#include "base/ds.h"
+
+// Stale handles must never resolve: not after the slot is reused, not once its generation runs
+// out and it is retired, and handle 0 never at all.
+
+SlotMap_Prototype(IntSlotMap, i32)
+SlotMap_Impl(IntSlotMap, i32)
+
+int main() {
+    IntSlotMap map = {0};
+    Check(!IntSlotMap_get(&map, 0), "handle 0 resolved in an empty map");
+    
+    SlotMapHandle first = IntSlotMap_insert(&map, -1);
+    Check(first != 0, "insert returned the null handle");
+    Check(IntSlotMap_erase(&map, first), "erasing a live handle failed");
+    Check(!IntSlotMap_erase(&map, first), "erasing a handle twice succeeded");
+    
+    // Slot 0 is reused until its generation runs out, then retired
+    u32 slot0_uses = 1;
+    for (i32 i = 0; i < 5000; i++) {
+        SlotMapHandle handle = IntSlotMap_insert(&map, i);
+        Check(handle != 0, "insert returned the null handle");
+        Check(*IntSlotMap_get(&map, handle) == i, "handle resolved to the wrong value");
+        if ((handle & SlotMap_IndexMask) == 0) slot0_uses++;
+        Check(IntSlotMap_erase(&map, handle), "erasing a live handle failed");
+    }
+    Check(slot0_uses == SlotMap_MaxGeneration, "slot 0 served %u generations", slot0_uses);
+    
+    // Keep live values around, including in the slot after the retired one
+    SlotMapHandle live[64];
+    for (i32 i = 0; i < 64; i++) live[i] = IntSlotMap_insert(&map, 5000 + i);
+    for (i32 i = 0; i < 64; i++) Check((live[i] & SlotMap_IndexMask) != 0, "a retired slot was handed out again");
+    
+    Check(!IntSlotMap_get(&map, 0), "handle 0 resolved");
+    Check(!IntSlotMap_erase(&map, 0), "handle 0 erased something");
+    Check(!IntSlotMap_get(&map, first), "a stale handle to the retired slot resolved");
+    Check(!IntSlotMap_erase(&map, first), "a stale handle to the retired slot erased something");
+    for (u32 generation = 0; generation <= SlotMap_MaxGeneration; generation++) {
+        Check(!IntSlotMap_get(&map, generation << SlotMap_IndexBits), "retired slot resolved at generation %u", generation);
+    }
+    
+    Check(map.len == 64, "map holds %u values, expected 64", map.len);
+    for (i32 i = 0; i < 64; i++) Check(*IntSlotMap_get(&map, live[i]) == 5000 + i, "live value changed");
+    
+    IntSlotMap_free(&map);
+    printf("slot_map: stale, retired and null handles rejected ok\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "test_common.h"
+#include "base/str.h"
+#include <string.h>
+#include <math.h>
+
+// Quality and speed of str_hash. Known answers pin the exact function (they match the reference
+// wyhash final4 with its default secret), the streaming hasher has to agree with the one-shot
+// hash under any chunking, flipping one input bit must flip every output bit about half the time,
+// and sequential names must spread evenly over power-of-two buckets.
+
+#define AvalancheKeys 2000
+#define AvalancheMaxBias 0.2 // Sampling noise alone reaches about 0.11 at 2000 keys
+#define BucketCount 1024
+#define BucketKeys (1 << 20)
+
+static u64 rng_state = 88172645463325252ull;
+
+static u64 rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void known_answers(void) {
+    struct { const char* key; u64 hash; u64 hash_seed_42; } cases[] = {
+        { "", 0x93228a4de0eec5a2ull, 0x2ac44db3deb05300ull },
+        { "a", 0xaced12527fe5bff8ull, 0x30dbb7b7a902ea66ull },
+        { "abc", 0x989b4a209c1011c9ull, 0xb0632d5ba93fcab5ull },
+        { "VK_KHR_swapchain", 0x60510d330c12e234ull, 0x07ff4a25db70c6adull },
+        { "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef!", 0x4d04fdf07f008452ull, 0x8b0f4122583f7057ull },
+    };
+    for (u32 i = 0; i < ArrayCount(cases); i++) {
+        string_const key = str_cstring((char*) cases[i].key);
+        Check(str_hash(key) == cases[i].hash, "str_hash(\"%s\") changed", cases[i].key);
+        Check(str_hash_seeded(key, 42) == cases[i].hash_seed_42, "str_hash_seeded(\"%s\", 42) changed", cases[i].key);
+    }
+}
+
+static void streaming_matches_one_shot(void) {
+    static u8 data[2048];
+    for (u32 i = 0; i < sizeof(data); i++) data[i] = (u8) rng_next();
+    
+    u64 max_chunks[] = { 1, 16, 17, 48, 49, 100, 2048 };
+    for (u64 len = 0; len <= 1024; len++) {
+        u64 seed = rng_next();
+        string_const whole = { data + len % 7, len };
+        u64 expected = str_hash_seeded(whole, seed);
+        for (u32 c = 0; c < ArrayCount(max_chunks); c++) {
+            str_hasher hasher;
+            str_hasher_init(&hasher, seed);
+            for (u64 offset = 0; offset < len;) {
+                u64 chunk = rng_next() % max_chunks[c] + 1;
+                chunk = Min(chunk, len - offset);
+                str_hasher_update(&hasher, (string_const) { whole.str + offset, chunk });
+                offset += chunk;
+            }
+            Check(str_hasher_final(&hasher) == expected, "streaming hash of %llu bytes in chunks up to %llu differs", len, max_chunks[c]);
+        }
+    }
+}
+
+static void avalanche(void) {
+    static u32 flips[256 * 8][64];
+    u32 lengths[] = { 4, 8, 16, 32, 64, 256 };
+    for (u32 l = 0; l < ArrayCount(lengths); l++) {
+        u32 len = lengths[l];
+        memset(flips, 0, sizeof(flips));
+        for (u32 k = 0; k < AvalancheKeys; k++) {
+            u8 key[256];
+            for (u32 i = 0; i < len; i++) key[i] = (u8) rng_next();
+            u64 base = str_hash((string_const) { key, len });
+            for (u32 bit = 0; bit < len * 8; bit++) {
+                key[bit >> 3] ^= 1 << (bit & 7);
+                u64 diff = base ^ str_hash((string_const) { key, len });
+                key[bit >> 3] ^= 1 << (bit & 7);
+                for (u32 out = 0; out < 64; out++) flips[bit][out] += (diff >> out) & 1;
+            }
+        }
+        f64 worst = 0;
+        for (u32 bit = 0; bit < len * 8; bit++) {
+            for (u32 out = 0; out < 64; out++) worst = Max(worst, fabs((f64) flips[bit][out] / AvalancheKeys - 0.5) * 2);
+        }
+        printf("str_hash: avalanche over %3u-byte keys, worst bias %.3f\n", len, worst);
+        Check(worst < AvalancheMaxBias, "avalanche bias %.3f over %u-byte keys", worst, len);
+    }
+}
+
+static void bucket_spread(void) {
+    static u32 buckets[BucketCount];
+    char name[32];
+    for (u32 i = 0; i < BucketKeys; i++) {
+        int size = snprintf(name, sizeof(name), "asset_%u.png", i);
+        buckets[str_hash((string_const) { (u8*) name, size }) & (BucketCount - 1)]++;
+    }
+    f64 expected = (f64) BucketKeys / BucketCount, chi2 = 0;
+    for (u32 i = 0; i < BucketCount; i++) chi2 += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+    // Five standard deviations above the mean of chi^2 with BucketCount - 1 degrees of freedom
+    f64 limit = (BucketCount - 1) + 5 * sqrt(2.0 * (BucketCount - 1));
+    printf("str_hash: chi^2 of %u sequential names over %u buckets %.0f (dof %u)\n", BucketKeys, BucketCount, chi2, BucketCount - 1);
+    Check(chi2 < limit, "sequential names cluster: chi^2 %.0f", chi2);
+}
+
+static void throughput(void) {
+    static u8 data[Megabytes(1) + 8];
+    for (u32 i = 0; i < sizeof(data); i++) data[i] = (u8) rng_next();
+    u64 sizes[] = { 8, 16, 32, 64, 256, 4096, Megabytes(1) };
+    u64 sink = 0;
+    for (u32 s = 0; s < ArrayCount(sizes); s++) {
+        u64 size = sizes[s];
+        u64 rounds = Max(Megabytes(64) / size, 50);
+        f64 start = T_Now();
+        for (u64 r = 0; r < rounds; r++) sink += str_hash((string_const) { data + (r & 7), size });
+        f64 seconds = T_Now() - start;
+        printf("str_hash: %8llu bytes %6.2f GB/s, %7.1f ns per hash\n", size, size * rounds / seconds / 1e9, seconds / rounds * 1e9);
+    }
+    Check(sink != 0, "hash loop optimized away");
+}
+
+int main() {
+    known_answers();
+    streaming_matches_one_shot();
+    avalanche();
+    bucket_spread();
+    throughput();
+    return 0;
+}
@@ -0,0 +1,76 @@
+/* date = October 18th 2026 9:05 am */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "defines.h"
+
+// Standalone tests for source/base. Each file is its own program: it prints what it checked and
+// exits non-zero on the first failed Check. Build them with build_tests.bat or build_tests.sh.
+
+#define Check(b, ...) do { if (!(b)) {\
+printf("FAILED %s:%d: ", FILE_NAME, __LINE__);\
+printf(__VA_ARGS__);\
+printf("\n");\
+exit(1);\
+} } while (false)
+
+#define ArrayCount(a) (sizeof(a) / sizeof((a)[0]))
+
+//~ Threads
+
+#ifdef PLATFORM_WIN
+#  include <windows.h>
+typedef HANDLE T_Thread;
+typedef DWORD (WINAPI *T_ThreadProc)(void*);
+#  define T_ThreadFunc(name) DWORD WINAPI name(void* arg)
+
+static inline T_Thread T_ThreadStart(T_ThreadProc proc, void* arg) {
+    return CreateThread(nullptr, 0, proc, arg, 0, nullptr);
+}
+
+static inline void T_ThreadJoin(T_Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+static inline void T_Yield(void) { SwitchToThread(); }
+#elif defined(PLATFORM_LINUX)
+#  include <pthread.h>
+#  include <sched.h>
+typedef pthread_t T_Thread;
+typedef void* (*T_ThreadProc)(void*);
+#  define T_ThreadFunc(name) void* name(void* arg)
+
+static inline T_Thread T_ThreadStart(T_ThreadProc proc, void* arg) {
+    pthread_t thread;
+    pthread_create(&thread, nullptr, proc, arg);
+    return thread;
+}
+
+static inline void T_ThreadJoin(T_Thread thread) {
+    pthread_join(thread, nullptr);
+}
+
+static inline void T_Yield(void) { sched_yield(); }
+#endif
+
+//~ Timing
+
+static inline f64 T_Now(void) {
+#ifdef PLATFORM_WIN
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (f64) counter.QuadPart / (f64) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+#endif //TEST_COMMON_H